@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// CPU pixel conversions shared by the sender side. All functions work on 4 byte per pixel
+// BGRA-ordered sources with arbitrary strides and never allocate.
+class CinderNDIConvert{
+	public:
+		// Resamples src into dst. Integer downscale factors use a box filter, anything else is bilinear.
+		static void scaleBGRA( const uint8_t* src, ptrdiff_t srcStride, int srcWidth, int srcHeight,
+							   uint8_t* dst, ptrdiff_t dstStride, int dstWidth, int dstHeight );
+
+		// BT.709 limited range 4:2:2, dstStride is at least ( ( width + 1 ) / 2 ) * 4: an odd last pixel fills a whole pixel pair.
+		static void bgraToUYVY( const uint8_t* src, ptrdiff_t srcStride, int width, int height, uint8_t* dst, ptrdiff_t dstStride );
+		// UYVY followed by the alpha plane at dst + height * dstStride with a stride of dstStride / 2, as NDI lays out UYVA.
+		// With a stride from CinderNDISender::calcLineStride() the color rows never run into the alpha plane.
+		static void bgraToUYVA( const uint8_t* src, ptrdiff_t srcStride, int width, int height, uint8_t* dst, ptrdiff_t dstStride );
+
+		// Straight to premultiplied alpha and back, src and dst may be the same buffer.
+		static void premultiplyBGRA( const uint8_t* src, ptrdiff_t srcStride, int width, int height, uint8_t* dst, ptrdiff_t dstStride );
+		static void unpremultiplyBGRA( const uint8_t* src, ptrdiff_t srcStride, int width, int height, uint8_t* dst, ptrdiff_t dstStride );
+
+		// Copies the alpha byte of every pixel into a single channel plane.
+		static void extractAlpha( const uint8_t* src, ptrdiff_t srcStride, int width, int height, uint8_t* dst, ptrdiff_t dstStride );
+};
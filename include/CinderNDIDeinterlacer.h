@@ -0,0 +1,50 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Texture.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/GlslProg.h"
+
+// Rebuilds full height frames from interlaced NDI video on the GPU. Fields are uploaded into
+// separate half height textures (frames with both fields interleaved are split during the upload
+// itself), and a single pass fills in the missing lines of the current field, so 1080i sources
+// come out at field rate with full vertical resolution and no CPU work per pixel.
+class CinderNDIDeinterlacer{
+	public:
+		enum class Mode {
+			Weave,			// interleaves the two most recent fields, sharp on static content but combs on motion
+			Bob,			// interpolates the missing lines from the current field, never combs but softens detail
+			MotionAdaptive	// weaves where the picture is still and bobs where it moves
+		};
+
+		CinderNDIDeinterlacer();
+
+		void setMode( Mode mode ) { mMode = mode; }
+		Mode getMode() const { return mMode; }
+		// Per pixel RGB difference between fields of equal parity above which MotionAdaptive starts to bob.
+		void setMotionThreshold( float threshold ) { mMotionThreshold = threshold; }
+		float getMotionThreshold() const { return mMotionThreshold; }
+
+		// Uploads a single field of BGRA lines. Field 0 holds the even lines of the frame, field 1 the odd ones.
+		void addField( const uint8_t* data, int stride, int width, int lines, int field );
+		// Uploads a frame with field 0 on the even and field 1 on the odd lines as two fields.
+		void addInterleavedFrame( const uint8_t* data, int stride, int width, int height );
+
+		// Renders a full height frame around the given field using the other fields received so far.
+		// Rows are stored in the same order as the uploaded lines.
+		ci::gl::Texture2dRef render( int field );
+
+		// Forgets all fields, for example after switching to another source.
+		void reset();
+	private:
+		void uploadField( const uint8_t* data, int rowLength, int width, int lines, int field );
+
+		Mode					mMode;
+		float					mMotionThreshold;
+
+		// per parity, the most recent field and the one before it.
+		ci::gl::Texture2dRef	mFields[2][2];
+		int						mNumFields[2];
+		ci::gl::FboRef			mFbo;
+		ci::gl::GlslProgRef		mProg;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+#include <Processing.NDI.Lib.h>
+
+#include "CinderNDIThreadPool.h"
+
+class CinderNDISourceMatcher;
+
+// Keeps the list of NDI sources on the network up to date from a blocking job on the shared
+// CinderNDIThreadPool, which only wakes when the list changes, and tells listeners which sources were added, removed or changed their address.
+// Receivers share getDefault() unless they are given their own instance, for example one limited to
+// some groups or with extra IPs for sources outside the local subnet.
+class CinderNDIDiscovery{
+	public:
+		struct Source {
+			std::string		name;		// "MACHINE (Stream)"
+			std::string		url;		// address NDI connects to, changes when a sender restarts
+		};
+
+		enum class Event {
+			Added,
+			Removed,
+			Changed		// same name at a new address
+		};
+
+		// Called from a thread pool worker, or from addListener() for the sources already known.
+		typedef std::function<void( Event event, const Source& source )> Listener;
+
+		// groups and extraIps are comma separated, empty means NDI's defaults.
+		CinderNDIDiscovery( bool showLocalSources = true, const std::string& groups = "", const std::string& extraIps = "" );
+		~CinderNDIDiscovery();
+
+		// The instance with default settings, created on first use and released with its last user.
+		static std::shared_ptr<CinderNDIDiscovery> getDefault();
+
+		std::vector<Source> getSources() const;
+		// Index over the current list for looking sources up by name or address. It is a snapshot that
+		// stays valid and unchanged, the next change to the list comes with a new one.
+		std::shared_ptr<const CinderNDISourceMatcher> getMatcher() const;
+		// Number of list changes seen so far, cheap to poll for apps that only redraw a source menu.
+		uint64_t getNumChanges() const { return mNumChanges; }
+
+		// With replay the listener first gets an Added event for every known source, so nothing falls between
+		// reading the list and subscribing. Returns an id for removeListener(), which waits for a running call
+		// of the listener to return and may be called from the listener itself.
+		size_t addListener( const Listener& listener, bool replay = true );
+		void removeListener( size_t id );
+	private:
+		CinderNDIThreadPool::Clock::time_point discover( bool mayBlock );
+		void updateSources();
+
+		NDIlib_find_instance_t		mNdiFinder;
+		std::string					mGroups, mExtraIps;
+
+		mutable std::mutex			mSourcesMutex;
+		std::vector<Source>			mSources;
+		std::shared_ptr<const CinderNDISourceMatcher>	mMatcher;
+		std::atomic<uint64_t>		mNumChanges;
+
+		std::recursive_mutex		mListenersMutex;		// held while listeners run
+		std::vector<std::pair<size_t, Listener>>	mListeners;
+		size_t						mNextListenerId;
+
+		std::shared_ptr<CinderNDIThreadPool>		mThreadPool;
+		std::shared_ptr<CinderNDIThreadPool::Job>	mJob;
+		bool						mHasSources;		// the first list was read
+};
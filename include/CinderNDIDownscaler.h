@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/GlslProg.h"
+
+#include "CinderNDISender.h"
+#include "CinderNDIReadback.h"
+
+// Publishes lower resolution variants of a rendered texture as separate NDI streams. Each variant
+// is filtered down on the GPU into its own Fbo and only read back at its final size, so a 720p
+// confidence output costs a 720p transfer instead of a full frame read and a CPU scale.
+class CinderNDIDownscaler{
+	public:
+		enum class Filter {
+			Mipmap,		// trilinear lookup into a mip chain of the source, cheapest for large factors
+			Box,		// averages the whole source footprint of each output pixel
+			Bilinear	// single filtered tap, only suitable for factors below two
+		};
+
+		CinderNDIDownscaler();
+
+		size_t addVariant( const std::string& name, const ci::ivec2& size, Filter filter = Filter::Box );
+		size_t getNumVariants() const { return mVariants.size(); }
+		CinderNDISender& getSender( size_t index ) { return *mVariants[index].sender; }
+		ci::gl::FboRef getFbo( size_t index ) { return mVariants[index].fbo; }
+
+		void setFramerate( int numerator, int denominator );
+
+		// Renders, reads back and sends every variant with a connected receiver. Like CinderNDIReadback the
+		// sent frames trail the source by one call.
+		void send( const ci::gl::Texture2dRef& source, long long timecode = NDIlib_send_timecode_synthesize );
+	private:
+		struct Variant {
+			ci::ivec2							size;
+			Filter								filter;
+			ci::gl::FboRef						fbo;
+			std::unique_ptr<CinderNDIReadback>	readback;
+			std::unique_ptr<CinderNDISender>	sender;
+		};
+
+		void render( Variant& variant, const ci::gl::Texture2dRef& source, const ci::gl::Texture2dRef& mipChain );
+		ci::gl::Texture2dRef updateMipChain( const ci::gl::Texture2dRef& source );
+
+		std::vector<Variant>	mVariants;
+		ci::gl::GlslProgRef		mBoxProg, mSampleProg;
+		ci::gl::FboRef			mMipFbo;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Monotonic tick source for an exact N/D frame rate. Deadlines are computed from the start time in
+// integer arithmetic so they never drift, and waiting sleeps for most of the interval before spinning
+// on the remainder to hit the deadline precisely despite coarse OS timers.
+class CinderNDIFrameClock{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		CinderNDIFrameClock( int numerator = 60000, int denominator = 1001 );
+
+		// Changes the rate and restarts the schedule from now.
+		void setRate( int numerator, int denominator );
+		void reset();
+
+		// Blocks until the next tick is due. Returns the number of ticks that were already overdue and got
+		// skipped, so a late caller resynchronises instead of bursting to catch up.
+		uint64_t waitForNextTick();
+
+		uint64_t getTickCount() const { return mTick; }
+		Clock::time_point getDeadline( uint64_t tick ) const;
+		// For callers woken by a timer of their own, such as a CinderNDIThreadPool job: when to wake up and
+		// call waitForNextTick() to still make the next tick. The margin follows how late those wake ups
+		// turn out, the same way the clock's own sleeps are tracked.
+		Clock::time_point getNextWakeTime();
+
+		// Upper bound on how long to spin before a deadline, the actual spin adapts to the observed sleep overshoot.
+		void setMaxSpin( std::chrono::microseconds maxSpin ) { mMaxSpin = maxSpin; }
+	private:
+		void waitUntil( Clock::time_point deadline );
+		void trackOvershoot( Clock::duration overshoot );
+
+		int							mNumerator, mDenominator;
+		Clock::time_point			mStart;
+		uint64_t					mTick;
+		std::chrono::nanoseconds	mSleepOvershoot;
+		Clock::time_point			mWakeTime;		// last getNextWakeTime(), until waitForNextTick() measured it
+		std::chrono::microseconds	mMaxSpin;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+
+#include <Processing.NDI.Lib.h>
+
+// Indexed container for raw NDI video frames, written by CinderNDIRecorder and replayed through a
+// memory mapping. The file holds a Header, the frames each starting on a kAlignment boundary with
+// their optional metadata string behind them, and finally the index with one IndexEntry per frame.
+// The header is completed when the writer is closed, a file whose recording was cut short has no frames.
+class CinderNDIFrameFile{
+	public:
+		static const uint32_t kVersion = 1;
+		static const uint32_t kAlignment = 4096;
+
+		struct Header {
+			char		magic[4];		// "CNDF"
+			uint32_t	version;
+			uint64_t	numFrames;
+			uint64_t	indexOffset;
+			uint32_t	alignment;
+			uint32_t	reserved;
+		};
+
+		struct IndexEntry {
+			uint64_t	offset;				// of the frame data from the start of the file
+			uint64_t	size;
+			int64_t		timecode;
+			uint32_t	fourCC;
+			int32_t		xres, yres;
+			int32_t		lineStride;
+			int32_t		frameRateN, frameRateD;
+			float		pictureAspectRatio;
+			int32_t		frameFormatType;
+			uint64_t	metadataOffset;		// NUL terminated, 0 when the frame had no metadata
+			uint32_t	metadataSize;		// without the terminator
+			uint32_t	reserved;
+		};
+};
+
+// Appends frames through a page aligned chunk that is written out whole, so the file sees few large
+// writes. addFrame() blocks on the disk and belongs on a writer thread.
+class CinderNDIFrameFileWriter{
+	public:
+		CinderNDIFrameFileWriter();
+		~CinderNDIFrameFileWriter();
+
+		bool open( const std::string& path );
+		// Writes the index and completes the header.
+		void close();
+		bool isOpen() const { return mFile != nullptr; }
+
+		// entry describes data, its offset fields are filled in by the writer.
+		bool addFrame( const CinderNDIFrameFile::IndexEntry& entry, const uint8_t* data, const char* metadata = nullptr );
+
+		uint64_t getNumFrames() const { return mIndex.size(); }
+		uint64_t getNumBytesWritten() const { return mNumBytesWritten; }
+	private:
+		void append( const void* data, size_t size );
+		void pad();
+		bool writeChunk( size_t size );
+
+		std::string								mPath;
+		std::FILE*								mFile;
+		std::unique_ptr<uint8_t[]>				mChunkStorage;
+		uint8_t*								mChunk;			// page aligned view into mChunkStorage
+		size_t									mChunkFill;
+		uint64_t								mFileOffset;	// of the next appended byte
+		uint64_t								mNumBytesWritten;
+		bool									mFailed;
+		std::vector<CinderNDIFrameFile::IndexEntry>	mIndex;
+};
+
+// Maps a frame file read-only. Frames are returned as views into the mapping without any copy and
+// stay valid until the reader is closed, so they can go straight into CinderNDISender::sendVideoFrame().
+// open() rejects files whose index or frame sizes don't fit the file, so no frame reads past the mapping.
+class CinderNDIFrameFileReader{
+	public:
+		CinderNDIFrameFileReader();
+		~CinderNDIFrameFileReader();
+
+		bool open( const std::string& path );
+		void close();
+		bool isOpen() const { return mData != nullptr; }
+
+		size_t getNumFrames() const { return mNumFrames; }
+		const CinderNDIFrameFile::IndexEntry& getEntry( size_t index ) const { return mEntries[index]; }
+		const uint8_t* getData( size_t index ) const { return mData + mEntries[index].offset; }
+		const char* getMetadata( size_t index ) const;
+
+		// The frame as NDI describes it, p_data and p_metadata point into the mapping.
+		NDIlib_video_frame_v2_t getVideoFrame( size_t index ) const;
+	private:
+		const uint8_t*							mData;
+		uint64_t								mSize;
+		const CinderNDIFrameFile::IndexEntry*	mEntries;
+		size_t									mNumFrames;
+#if defined( _WIN32 )
+		void*									mFileHandle;
+		void*									mMappingHandle;
+#else
+		int										mFileDescriptor;
+#endif
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Fast non-cryptographic 64 bit hash of image rows, used for change detection. The inner loop folds
+// 64 bytes per iteration into eight independent 64 bit accumulators (four SSE2 registers when
+// available, an equivalent scalar path otherwise), so it runs at close to memory bandwidth.
+class CinderNDIFrameHash{
+	public:
+		static uint64_t calc( const uint8_t* data, size_t rowBytes, int rows, ptrdiff_t stride, uint64_t seed = 0 );
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+#include "CinderNDISender.h"
+#include "CinderNDIThreadPool.h"
+#include "CinderNDIFrameClock.h"
+
+// Sends frames produced on the CPU without a GL context or render loop. A job on the shared
+// CinderNDIThreadPool paces the output at the sender's framerate and asks the producer to fill the
+// next slot of a preallocated frame ring in place. The job is its own clock, so leave pacing on the
+// underlying sender disabled.
+class CinderNDIHeadlessSender{
+	public:
+		struct Frame {
+			uint8_t*				data;
+			int						width, height;
+			int						stride;
+			NDIlib_FourCC_type_e	fourCC;
+			long long				timecode;	// Defaults to NDIlib_send_timecode_synthesize, producers may overwrite it.
+			uint64_t				index;		// Monotonic count of frames requested from the producer.
+		};
+
+		// Fills frame.data in place, on a thread pool worker. Returning false skips this tick and nothing is sent.
+		typedef std::function<bool( Frame& frame )> ProducerFn;
+
+		CinderNDIHeadlessSender( const std::string name, int width, int height, NDIlib_FourCC_type_e fourCC = NDIlib_FourCC_type_BGRX, size_t ringSize = 3 );
+		~CinderNDIHeadlessSender();
+
+		void setFramerate( int numerator, int denominator );
+		void setProducer( const ProducerFn& producer );
+
+		void start();
+		void stop();
+		bool isRunning() const { return mRunning; }
+
+		uint64_t getNumFramesSent() const { return mNumFramesSent; }
+		uint64_t getNumFramesSkipped() const { return mNumFramesSkipped; }
+
+		CinderNDISender& getSender() { return mSender; }
+		std::string getName() { return mSender.getName(); }
+	private:
+		CinderNDIThreadPool::Clock::time_point send();
+
+		CinderNDISender							mSender;
+		int										mWidth, mHeight, mStride;
+		NDIlib_FourCC_type_e					mFourCC;
+		std::vector<std::unique_ptr<uint8_t[]>>	mRing;
+		size_t									mRingIndex;
+
+		ProducerFn								mProducer;
+		std::shared_ptr<CinderNDIThreadPool>		mThreadPool;
+		std::shared_ptr<CinderNDIThreadPool::Job>	mSendJob;
+		CinderNDIFrameClock						mClock;
+		int										mClockNumerator, mClockDenominator;
+		uint64_t								mFrameIndex;
+		std::atomic_bool						mRunning;
+		std::atomic<uint64_t>					mNumFramesSent, mNumFramesSkipped;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include "CinderNDISender.h"
+#include "CinderNDIFrameFile.h"
+#include "CinderNDIThreadPool.h"
+#include "CinderNDIFrameClock.h"
+
+// Drives many named senders at once to load test receiving machines. Every tick of a single paced
+// CinderNDIThreadPool job submits one frame to each connected sender asynchronously, so NDI compresses all of them in
+// parallel. Frames come from a small set of synthetic patterns or from a recorded CinderNDIFrameFile
+// played in a loop, and are only read, so all senders share them without copies.
+class CinderNDILoadGenerator{
+	public:
+		struct Stats {
+			uint64_t	framesSent;
+			uint64_t	ticksMissed;		// ticks skipped because the previous round of sends overran
+			double		framesPerSecond;	// achieved since start()
+			double		meanSendLatency;	// seconds spent in the send call, which waits for the previous async frame
+			double		maxSendLatency;
+		};
+
+		// Synthetic patterns are generated at this size, fourCC can be BGRX, BGRA or UYVY.
+		CinderNDILoadGenerator( int width = 1920, int height = 1080, NDIlib_FourCC_type_e fourCC = NDIlib_FourCC_type_BGRX );
+		~CinderNDILoadGenerator();
+
+		void setFramerate( int numerator, int denominator );
+		// Replays the frames of a recording instead of the patterns. The file stays mapped while in use.
+		bool setReplayFile( const std::string& path );
+
+		// Adds count senders named baseName 1 ... baseName count.
+		void addSenders( const std::string& baseName, size_t count );
+		size_t getNumSenders() const { return mSenders.size(); }
+		CinderNDISender& getSender( size_t index ) { return *mSenders[index]->sender; }
+
+		void start();
+		void stop();
+		bool isRunning() const { return mRunning; }
+
+		Stats getStats( size_t index ) const;
+		// Frames are summed over all senders, the rate is the per sender average and latencies cover every send.
+		Stats getTotalStats() const;
+	private:
+		struct SenderState {
+			std::unique_ptr<CinderNDISender>	sender;
+			std::atomic<uint64_t>				framesSent;
+			std::atomic<uint64_t>				latencyNanosTotal, latencyNanosMax;
+		};
+
+		void generatePatterns();
+		NDIlib_video_frame_v2_t getFrame( uint64_t index ) const;
+		CinderNDIThreadPool::Clock::time_point send();
+
+		int											mWidth, mHeight;
+		NDIlib_FourCC_type_e						mFourCC;
+		int											mFramerateNumerator, mFramerateDenominator;
+		std::vector<std::vector<uint8_t>>			mPatterns;
+		CinderNDIFrameFileReader					mReplayFile;
+
+		std::vector<std::unique_ptr<SenderState>>	mSenders;
+		std::shared_ptr<CinderNDIThreadPool>		mThreadPool;
+		std::shared_ptr<CinderNDIThreadPool::Job>	mSendJob;
+		CinderNDIFrameClock							mClock;
+		std::atomic_bool							mRunning;
+		std::atomic<uint64_t>						mTicksMissed;
+		std::atomic<int64_t>						mStartTime;		// steady_clock ticks
+};
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free hand-offs between threads. All storage is allocated by the constructor, so pushing and
+// popping never allocate, and the indices each side writes are padded apart onto their own cache lines
+// so producer and consumer don't slow each other down. Padding rather than alignas keeps the classes
+// usable as members of objects created with new before C++17. Elements are reused in place: large
+// buffers such as std::vector keep their capacity when they are swapped back in.
+
+namespace CinderNDIQueueDetail {
+
+const size_t kCacheLineSize = 64;
+
+inline size_t roundUpToPowerOfTwo( size_t value )
+{
+	size_t result = 1;
+	while( result < value ) {
+		result <<= 1;
+	}
+	return result;
+}
+
+} // namespace CinderNDIQueueDetail
+
+// Bounded queue for exactly one producer thread and one consumer thread. The capacity is rounded up to
+// a power of two.
+template<typename T>
+class CinderNDISpscQueue{
+	public:
+		explicit CinderNDISpscQueue( size_t capacity )
+			: mSlots( CinderNDIQueueDetail::roundUpToPowerOfTwo( capacity ) ), mMask{ mSlots.size() - 1 },
+			mHead{ 0 }, mCachedTail{ 0 }, mTail{ 0 }, mCachedHead{ 0 }
+		{
+		}
+
+		CinderNDISpscQueue( const CinderNDISpscQueue& ) = delete;
+		CinderNDISpscQueue& operator=( const CinderNDISpscQueue& ) = delete;
+
+		// Producer side, false when the queue is full and value was left untouched.
+		bool push( T&& value )
+		{
+			const size_t tail = mTail.load( std::memory_order_relaxed );
+			if( ! hasSpace( tail ) ) {
+				return false;
+			}
+			mSlots[tail & mMask] = std::move( value );
+			mTail.store( tail + 1, std::memory_order_release );
+			return true;
+		}
+		bool push( const T& value )
+		{
+			T copy( value );
+			return push( std::move( copy ) );
+		}
+		// Like push(), but value gets the slot's previous content in return: the buffer a consumer left
+		// there with pop(), so buffers circulate between the two sides without being allocated again.
+		bool pushSwap( T& value )
+		{
+			const size_t tail = mTail.load( std::memory_order_relaxed );
+			if( ! hasSpace( tail ) ) {
+				return false;
+			}
+			std::swap( mSlots[tail & mMask], value );
+			mTail.store( tail + 1, std::memory_order_release );
+			return true;
+		}
+
+		// Consumer side, false when the queue is empty.
+		bool pop( T& value )
+		{
+			const size_t head = mHead.load( std::memory_order_relaxed );
+			if( head == mCachedTail ) {
+				mCachedTail = mTail.load( std::memory_order_acquire );
+				if( head == mCachedTail ) {
+					return false;
+				}
+			}
+			// swapped rather than moved out, so the slot keeps the consumer's old buffer for reuse.
+			std::swap( value, mSlots[head & mMask] );
+			mHead.store( head + 1, std::memory_order_release );
+			return true;
+		}
+
+		// Only exact while neither side runs, otherwise a snapshot.
+		size_t size() const { return mTail.load( std::memory_order_acquire ) - mHead.load( std::memory_order_acquire ); }
+		bool empty() const { return size() == 0; }
+		size_t capacity() const { return mSlots.size(); }
+	private:
+		bool hasSpace( size_t tail )
+		{
+			if( tail - mCachedHead < mSlots.size() ) {
+				return true;
+			}
+			mCachedHead = mHead.load( std::memory_order_acquire );
+			return tail - mCachedHead < mSlots.size();
+		}
+
+		std::vector<T>							mSlots;
+		const size_t							mMask;
+
+		// consumer side, with its copy of the producer's index.
+		char									mPad0[CinderNDIQueueDetail::kCacheLineSize];
+		std::atomic<size_t>						mHead;
+		size_t									mCachedTail;
+		// producer side, with its copy of the consumer's index.
+		char									mPad1[CinderNDIQueueDetail::kCacheLineSize];
+		std::atomic<size_t>						mTail;
+		size_t									mCachedHead;
+		char									mPad2[CinderNDIQueueDetail::kCacheLineSize];
+};
+
+// Bounded queue for any number of producer threads and one consumer thread. Each slot carries a sequence
+// number, so producers only contend on claiming a slot and a slow producer never blocks the others. The
+// capacity is rounded up to a power of two.
+template<typename T>
+class CinderNDIMpscQueue{
+	public:
+		explicit CinderNDIMpscQueue( size_t capacity )
+			: mCapacity{ CinderNDIQueueDetail::roundUpToPowerOfTwo( capacity ) }, mMask{ mCapacity - 1 },
+			mCells{ new Cell[mCapacity] }, mDequeuePos{ 0 }, mEnqueuePos{ 0 }
+		{
+			for( size_t i = 0; i < mCapacity; ++i ) {
+				mCells[i].sequence.store( i, std::memory_order_relaxed );
+			}
+		}
+
+		CinderNDIMpscQueue( const CinderNDIMpscQueue& ) = delete;
+		CinderNDIMpscQueue& operator=( const CinderNDIMpscQueue& ) = delete;
+
+		// Any thread, false when the queue is full and value was left untouched.
+		bool push( T&& value )
+		{
+			size_t pos = mEnqueuePos.load( std::memory_order_relaxed );
+			Cell* cell;
+			while( true ) {
+				cell = &mCells[pos & mMask];
+				const size_t sequence = cell->sequence.load( std::memory_order_acquire );
+				const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+				if( diff == 0 ) {
+					if( mEnqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+						break;
+					}
+				}
+				else if( diff < 0 ) {
+					// the consumer hasn't freed this slot since the last lap.
+					return false;
+				}
+				else {
+					pos = mEnqueuePos.load( std::memory_order_relaxed );
+				}
+			}
+			cell->value = std::move( value );
+			cell->sequence.store( pos + 1, std::memory_order_release );
+			return true;
+		}
+		bool push( const T& value )
+		{
+			T copy( value );
+			return push( std::move( copy ) );
+		}
+
+		// Consumer side, false when the queue is empty or the oldest push is still being written.
+		bool pop( T& value )
+		{
+			Cell& cell = mCells[mDequeuePos & mMask];
+			if( cell.sequence.load( std::memory_order_acquire ) != mDequeuePos + 1 ) {
+				return false;
+			}
+			std::swap( value, cell.value );
+			cell.sequence.store( mDequeuePos + mCapacity, std::memory_order_release );
+			++mDequeuePos;
+			return true;
+		}
+
+		size_t capacity() const { return mCapacity; }
+	private:
+		struct Cell {
+			std::atomic<size_t>		sequence;
+			T						value;
+		};
+
+		const size_t							mCapacity, mMask;
+		std::unique_ptr<Cell[]>					mCells;
+
+		char									mPad0[CinderNDIQueueDetail::kCacheLineSize];
+		size_t									mDequeuePos;
+		char									mPad1[CinderNDIQueueDetail::kCacheLineSize];
+		std::atomic<size_t>						mEnqueuePos;
+		char									mPad2[CinderNDIQueueDetail::kCacheLineSize];
+};
+
+// Hands the newest value from one producer thread to one consumer thread. Neither side ever waits: the
+// producer fills its own buffer and publishes it, the consumer picks up whatever was published last, and
+// values replaced before the consumer got to them are counted as overwritten.
+template<typename T>
+class CinderNDITripleBuffer{
+	public:
+		CinderNDITripleBuffer()
+			: mReadIndex{ 0 }, mState{ 1 }, mWriteIndex{ 2 }, mNumPublished{ 0 }, mNumOverwritten{ 0 }
+		{
+		}
+
+		CinderNDITripleBuffer( const CinderNDITripleBuffer& ) = delete;
+		CinderNDITripleBuffer& operator=( const CinderNDITripleBuffer& ) = delete;
+
+		// Producer side. The buffer holds whatever was published three values ago, or a default T.
+		T& getWriteBuffer() { return mBuffers[mWriteIndex]; }
+		// Makes the write buffer the newest value and hands the producer another one. Returns false when
+		// this replaced a value the consumer never picked up.
+		bool publish()
+		{
+			const uint8_t previous = mState.exchange( (uint8_t)( mWriteIndex | kFresh ), std::memory_order_acq_rel );
+			mWriteIndex = previous & kIndexMask;
+			++mNumPublished;
+			if( previous & kFresh ) {
+				++mNumOverwritten;
+				return false;
+			}
+			return true;
+		}
+
+		// Consumer side. Switches the read buffer to the newest value, returns false when nothing new was
+		// published and the read buffer is unchanged.
+		bool update()
+		{
+			if( ! ( mState.load( std::memory_order_relaxed ) & kFresh ) ) {
+				return false;
+			}
+			mReadIndex = mState.exchange( mReadIndex, std::memory_order_acq_rel ) & kIndexMask;
+			return true;
+		}
+		T& getReadBuffer() { return mBuffers[mReadIndex]; }
+
+		uint64_t getNumPublished() const { return mNumPublished; }
+		uint64_t getNumOverwritten() const { return mNumOverwritten; }
+	private:
+		static const uint8_t kIndexMask = 3;
+		static const uint8_t kFresh = 4;
+
+		T										mBuffers[3];
+
+		char									mPad0[CinderNDIQueueDetail::kCacheLineSize];
+		uint8_t									mReadIndex;
+		char									mPad1[CinderNDIQueueDetail::kCacheLineSize];
+		// the buffer between the two sides, with kFresh while the consumer hasn't taken it.
+		std::atomic<uint8_t>					mState;
+		char									mPad2[CinderNDIQueueDetail::kCacheLineSize];
+		uint8_t									mWriteIndex;
+		std::atomic<uint64_t>					mNumPublished, mNumOverwritten;
+		char									mPad3[CinderNDIQueueDetail::kCacheLineSize];
+};
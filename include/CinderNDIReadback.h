@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/Pbo.h"
+#include "cinder/Surface.h"
+
+// Reads an FBO back into a persistent BGRA Surface through two PBOs, so the CPU only touches data
+// that was requested one frame earlier and never stalls on the GPU. Only the areas reported dirty
+// for a frame are transferred and patched into the Surface, everything else keeps its old content.
+// Rows are stored bottom-up as OpenGL returns them.
+class CinderNDIReadback{
+	public:
+		CinderNDIReadback( int width, int height );
+
+		// Marks an area in window coordinates (upper-left origin) as changed for the next readback.
+		void addDirtyArea( const ci::Area& area );
+		void markAllDirty();
+
+		// Starts reading this frame's dirty areas of fbo and patches the areas started by the previous call
+		// into the Surface. Returns true when the Surface changed.
+		bool readback( const ci::gl::FboRef& fbo );
+
+		ci::Surface8uRef getSurface() { return mSurface; }
+		int getWidth() const { return mWidth; }
+		int getHeight() const { return mHeight; }
+
+		uint64_t getNumBytesReadBack() const { return mNumBytesReadBack; }
+	private:
+		void resolve( size_t index );
+
+		int							mWidth, mHeight;
+		ci::Surface8uRef			mSurface;
+		ci::gl::PboRef				mPbo[2];
+		std::vector<ci::Area>		mPboAreas[2];	// GL (lower-left origin) areas pending in each PBO
+		size_t						mWriteIndex;
+		std::vector<ci::Area>		mDirtyAreas;
+		uint64_t					mNumBytesReadBack;
+};
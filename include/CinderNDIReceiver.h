@@ -5,14 +5,29 @@
 #include <Processing.NDI.Lib.h>
 #include <thread>
 #include <atomic>
+#include <functional>
+#include <chrono>
+#include <mutex>
+#include <deque>
 #include "cinder/gl/Texture.h"
+#include "cinder/Channel.h"
+
+#include "CinderNDIDeinterlacer.h"
+#include "CinderNDIRecorder.h"
+#include "CinderNDIUploadScheduler.h"
+#include "CinderNDIDiscovery.h"
+#include "CinderNDISourceMatcher.h"
+#include "CinderNDIQueues.h"
+#include "CinderNDIThreadPool.h"
 
 class CinderNDIReceiver{
 	public:
 		CinderNDIReceiver();
 		~CinderNDIReceiver();
 
-		void setup(std::string preferredSender = "");
+		// Connects to the source matching preferredSender, or to the first one found when it is empty. A
+		// name that matches several sources connects to none of them until it is unambiguous.
+		void setup(std::string preferredSender = "", CinderNDISourceMatcher::Mode matchMode = CinderNDISourceMatcher::Mode::Exact);
 
 		bool isReady();
 
@@ -20,6 +35,100 @@ class CinderNDIReceiver{
 		std::pair<std::string, long long> getMetadata();
 		std::pair<ci::gl::Texture2dRef, long long> getVideoTexture();
 
+		// Splits the alpha of frames from senders with a key into a separate single channel texture,
+		// for compositing code that wants fill and key apart. Null while the source has no alpha.
+		void setAlphaTextureEnabled( bool enabled ) { mAlphaTextureEnabled = enabled; }
+		ci::gl::Texture2dRef getAlphaTexture() { return mAlphaTexture; }
+		// True when the last received frame carried alpha (NDI delivered it as BGRA instead of BGRX).
+		bool hasAlpha() const { return mHasAlpha; }
+
+		// How interlaced sources are turned into frames, progressive sources are unaffected. Bob and
+		// MotionAdaptive emit one frame per field, so update() should run at the field rate.
+		void setDeinterlaceMode( CinderNDIDeinterlacer::Mode mode ) { mDeinterlacer.setMode( mode ); }
+		CinderNDIDeinterlacer& getDeinterlacer() { return mDeinterlacer; }
+		// True when the last received video frame was fielded.
+		bool isInterlaced() const { return mInterlaced; }
+
+		// Records the incoming video. Sources that support NDI recording store their own compressed stream and
+		// treat path as a hint only, for all others the received frames are written raw by a CinderNDIRecorder.
+		bool startRecording( const std::string& path );
+		void stopRecording();
+		bool isRecording();
+		bool isRecordingRemotely() const { return mRemoteRecording; }
+		CinderNDIRecorder& getRecorder() { return mRecorder; }
+
+		// Called from update() with every received video frame before NDI gets it back.
+		typedef std::function<void( const NDIlib_video_frame_v2_t& videoFrame )> VideoFrameCallback;
+		void setVideoFrameCallback( const VideoFrameCallback& callback ) { mVideoFrameCallback = callback; }
+		// Captures on a CinderNDIThreadPool worker instead of in update(). The worker copies every frame as it
+		// arrives and update() takes the newest one, so a slow render loop never leaves NDI queueing old frames
+		// and neither side waits for the other. Callbacks still run in update(), with the newest video frame
+		// and all audio and metadata received since the last call.
+		void setCaptureThreadEnabled( bool enabled );
+		bool isCaptureThreadEnabled() const { return mCaptureThreadEnabled; }
+		// Frames the capture worker replaced before update() picked them up.
+		uint64_t getNumOverwrittenFrames() const { return mCapturedFrames.getNumOverwritten(); }
+
+		// Disables the receiver's own textures for code that consumes frames through the callback only.
+		void setTextureUploadEnabled( bool enabled ) { mTextureUploadEnabled = enabled; }
+		// Audio is only received while an audio callback is set. update() passes on all audio and metadata
+		// that arrived before the next video frame, so they don't hold video back.
+		typedef std::function<void( const NDIlib_audio_frame_v2_t& audioFrame )> AudioFrameCallback;
+		void setAudioFrameCallback( const AudioFrameCallback& callback ) { mAudioFrameCallback = callback; mCaptureAudio = (bool)callback; }
+		typedef std::function<void( const NDIlib_metadata_frame_t& metadataFrame )> MetadataFrameCallback;
+		void setMetadataFrameCallback( const MetadataFrameCallback& callback ) { mMetadataFrameCallback = callback; }
+
+		// How the app shows this source. It sets the tally sent to the source and the upload priority, and a
+		// source hidden for longer than the hidden delay is reconnected at the hidden bandwidth, proxy by
+		// default, until it is shown again. Program is the default.
+		enum class Usage {
+			Program,
+			Preview,
+			Hidden
+		};
+		void setUsage( Usage usage );
+		Usage getUsage() const { return mUsage; }
+		// NDIlib_recv_bandwidth_metadata_only stops the video of hidden sources altogether.
+		void setHiddenBandwidth( NDIlib_recv_bandwidth_e bandwidth ) { mHiddenBandwidth = bandwidth; }
+		// Seconds a source stays hidden before its bandwidth drops, so briefly hidden tiles don't reconnect.
+		void setHiddenDelay( double seconds ) { mHiddenDelay = seconds; }
+		NDIlib_recv_bandwidth_e getBandwidth() const { return mBandwidth; }
+
+		// Shares an upload budget with other receivers, see CinderNDIUploadScheduler. Pass null to upload
+		// every frame again.
+		void setUploadScheduler( const std::shared_ptr<CinderNDIUploadScheduler>& scheduler );
+		CinderNDIUploadScheduler::Priority getUploadPriority() const;
+
+		// Sources come from a shared CinderNDIDiscovery unless a different one is set before setup().
+		void setDiscovery( const std::shared_ptr<CinderNDIDiscovery>& discovery ) { mDiscovery = discovery; }
+
+		// Watchdog run by update(): a source that delivers no video for the stall timeout or leaves the network
+		// is reconnected with exponential backoff. With a backup source the receiver fails over to it after
+		// failoverAttempts unsuccessful reconnects and returns as soon as the preferred source is back.
+		enum class State {
+			Searching,		// not connected yet
+			Connected,		// receiving from the preferred source
+			Stalled,		// the source stopped or disappeared
+			Reconnecting,	// waiting for video after a reconnect
+			FailedOver		// receiving from the backup source
+		};
+		struct StateChange {
+			State									state;
+			std::chrono::system_clock::time_point	time;
+			std::string								sourceName;
+			std::string								reason;
+		};
+		typedef std::function<void( const StateChange& change )> StateCallback;
+		// Called from update() on every state change.
+		void setStateCallback( const StateCallback& callback ) { mStateCallback = callback; }
+		State getState() const { return mState; }
+		// The most recent changes, oldest first.
+		std::vector<StateChange> getStateHistory();
+		// 0 disables stall detection. Keep it above the keep-alive of deduplicating or throttled senders.
+		void setStallTimeout( double seconds ) { mStallTimeout = seconds; }
+		void setReconnectBackoff( double initialSeconds, double maxSeconds );
+		void setBackupSource( const std::string& name, int failoverAttempts = 2, CinderNDISourceMatcher::Mode matchMode = CinderNDISourceMatcher::Mode::Exact );
+
 		int getCurrentSenderIndex();
 		std::string getCurrentSenderName();
 		int getNumberOfSendersFound();
@@ -28,6 +137,13 @@ class CinderNDIReceiver{
 
 	private:
 		void initConnection(int index);
+		void connect( const CinderNDIDiscovery::Source& source, bool backup = false );
+		void connectPendingSource();
+		void updateWatchdog();
+		void setState( State state, const std::string& reason );
+		bool isPrimarySource( const CinderNDIDiscovery::Source& source ) const;
+		bool findSource( const std::string& pattern, CinderNDISourceMatcher::Mode mode, CinderNDIDiscovery::Source& source ) const;
+		void onSourceEvent( CinderNDIDiscovery::Event event, const CinderNDIDiscovery::Source& source );
 
 		int getIndexForSender(std::string name);
 
@@ -36,21 +152,106 @@ class CinderNDIReceiver{
 		std::atomic_bool mConnecting;
 		std::pair<ci::gl::Texture2dRef, long long> mVideoTexture;
 		bool mNewFrame = false;
+		bool mAlphaTextureEnabled = false;
+		bool mHasAlpha = false;
+		ci::gl::Texture2dRef mAlphaTexture;
+		ci::Channel8u mAlphaChannel;
+
+		CinderNDIDeinterlacer mDeinterlacer;
+		bool mInterlaced;
+		int mPendingField;
+		long long mPendingFieldTimecode;
+
+		CinderNDIRecorder mRecorder;
+		bool mRemoteRecording;
+		VideoFrameCallback mVideoFrameCallback;
+		AudioFrameCallback mAudioFrameCallback;
+		MetadataFrameCallback mMetadataFrameCallback;
+		bool mTextureUploadEnabled;
+		void uploadVideoFrame( const NDIlib_video_frame_v2_t& videoFrame );
+		void handleVideoFrame( const NDIlib_video_frame_v2_t& videoFrame );
+		void handleMetadataFrame( const NDIlib_metadata_frame_t& metadataFrame );
+
+		// frames copied by the capture thread, p_data and p_metadata point into the copies.
+		struct CapturedVideoFrame {
+			NDIlib_video_frame_v2_t		videoFrame;
+			std::vector<uint8_t>		data;
+			std::string					metadata;
+		};
+		struct CapturedAudioFrame {
+			NDIlib_audio_frame_v2_t		audioFrame;
+			std::vector<float>			data;
+			std::string					metadata;
+		};
+		struct CapturedMetadataFrame {
+			std::string					data;
+			long long					timecode;
+		};
+		void startCapture();
+		void stopCapture();
+		CinderNDIThreadPool::Clock::time_point capture( bool mayBlock );
+		void receiveCapturedFrames();
+		bool mCaptureThreadEnabled;
+		std::shared_ptr<CinderNDIThreadPool> mThreadPool;
+		std::shared_ptr<CinderNDIThreadPool::Job> mCaptureJob;
+		std::atomic_bool mCaptureAudio;
+		CinderNDITripleBuffer<CapturedVideoFrame> mCapturedFrames;
+		CinderNDISpscQueue<CapturedAudioFrame> mCapturedAudio;
+		// one buffer on each side, swapped through the queue so audio buffers are reused.
+		CapturedAudioFrame mCaptureAudioFrame, mReceiveAudioFrame;
+		CinderNDISpscQueue<CapturedMetadataFrame> mCapturedMetadata;
+
+		Usage mUsage;
+		NDIlib_recv_bandwidth_e mBandwidth;
+		NDIlib_recv_bandwidth_e mHiddenBandwidth;
+		double mHiddenDelay;
+		std::chrono::steady_clock::time_point mHiddenSince;
+		void updateBandwidth();
+
+		std::shared_ptr<CinderNDIUploadScheduler> mUploadScheduler;
+		// newest frame the scheduler deferred, p_data points into mDeferredData.
+		NDIlib_video_frame_v2_t mDeferredFrame;
+		std::vector<uint8_t> mDeferredData;
+		bool mHasDeferredFrame;
+		void scheduleVideoFrame( const NDIlib_video_frame_v2_t& videoFrame );
+		void deferVideoFrame( const NDIlib_video_frame_v2_t& videoFrame );
+		void sendTally();
 		bool getIsNewFrame();
 
 		std::pair<std::string, long long> mMetadata;
 		NDIlib_recv_instance_t mNdiReceiver;
-		NDIlib_find_instance_t mNdiFinder;
-		const NDIlib_source_t* mNdiSources = nullptr; // Owned by NDI.
+		std::shared_ptr<CinderNDIDiscovery> mDiscovery;
+		size_t mDiscoveryListener;
 
-		std::vector<std::string> mNDIsenderNames;
+		std::mutex mSourcesMutex;
+		std::vector<CinderNDIDiscovery::Source> mSources;		// as last reported by the discovery
+		CinderNDIDiscovery::Source mCurrentSource;
+		// a source the discovery asked to connect to, connected from update() so the receiver is never
+		// recreated while update() captures from it.
+		CinderNDIDiscovery::Source mPendingSource;
+		bool mHasPendingSource;
 		std::atomic_int mCurrentIndex;
 		std::string mPreferredSenderName;
+		CinderNDISourceMatcher::Mode mMatchMode;
 		bool shouldWaitForPreferredSender();
 
-		std::shared_ptr<std::thread> mSourceFindingThread;
-		bool mQuitSourceFindingThread;
-		void threadedSourceFind();
+		std::atomic<State> mState;
+		StateCallback mStateCallback;
+		std::mutex mStateHistoryMutex;
+		std::deque<StateChange> mStateHistory;
+		std::string mPrimarySenderName;		// preferred name, or the full name of a source picked otherwise
+		CinderNDISourceMatcher::Mode mPrimaryMatchMode;
+		std::string mBackupSenderName;
+		CinderNDISourceMatcher::Mode mBackupMatchMode;
+		int mFailoverAttempts;
+		std::atomic_bool mOnBackup;
+		std::atomic_bool mSourceLost;
+		std::atomic_bool mPrimaryReturned;	// set by the discovery, handled by the watchdog in update()
+		double mStallTimeout;
+		double mReconnectBackoff, mMaxReconnectBackoff;
+		int mReconnectAttempts;
+		std::chrono::steady_clock::time_point mLastVideoTime;
+		std::chrono::steady_clock::time_point mNextReconnectTime;
 
 		bool mVerbose;
 };
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include <Processing.NDI.Lib.h>
+
+#include "CinderNDIFrameFile.h"
+#include "CinderNDIQueues.h"
+#include "CinderNDIThreadPool.h"
+
+// Writes raw received video frames to a CinderNDIFrameFile from a CinderNDIThreadPool job on a blocking
+// lane, so disk writes never hold up the workers that pace video. The capture side only copies the frame
+// into a buffer from a bounded pool and queues it; when the disk falls behind and the pool is used up new
+// frames are dropped and counted, so a slow disk never stalls capture.
+class CinderNDIRecorder{
+	public:
+		// maxBufferedBytes bounds the memory of frames waiting for the disk.
+		CinderNDIRecorder( size_t maxBufferedBytes = 512 * 1024 * 1024 );
+		~CinderNDIRecorder();
+
+		bool start( const std::string& path );
+		// Writes everything still queued and closes the file.
+		void stop();
+		// False as well once a write failed, call stop() to close what was written.
+		bool isRecording() const { return mRecording; }
+		const std::string& getPath() const { return mPath; }
+
+		// Queues a copy of the frame, returns false when it was dropped. Safe to call from the capture thread.
+		bool addFrame( const NDIlib_video_frame_v2_t& videoFrame );
+
+		uint64_t getNumFramesWritten() const { return mNumFramesWritten; }
+		uint64_t getNumFramesDropped() const { return mNumFramesDropped; }
+		uint64_t getNumBytesWritten() const { return mNumBytesWritten; }
+		size_t getNumBytesBuffered() const { return mNumBytesBuffered; }
+		// Average disk throughput since start().
+		double getBytesPerSecond() const;
+
+		// Bytes of the packed frame data, 0 for unsupported formats.
+		static size_t calcFrameSize( const NDIlib_video_frame_v2_t& videoFrame );
+	private:
+		struct Frame {
+			CinderNDIFrameFile::IndexEntry	entry;
+			std::vector<uint8_t>			data;
+			std::string						metadata;
+		};
+
+		CinderNDIThreadPool::Clock::time_point write( bool mayBlock );
+		bool writeQueuedFrame();
+
+		std::string								mPath;
+		CinderNDIFrameFileWriter				mWriter;
+		size_t									mMaxBufferedBytes;
+
+		// frames go to the write job through mQueue and come back through mFreeFrames, so steady state
+		// recording doesn't allocate.
+		CinderNDISpscQueue<std::unique_ptr<Frame>>	mQueue, mFreeFrames;
+		std::atomic<size_t>						mNumBytesBuffered;
+		// wakes the write job when a frame was queued or stop() was called.
+		std::mutex								mWriteMutex;
+		std::condition_variable					mWriteCondition;
+		bool									mStopping;
+
+		std::shared_ptr<CinderNDIThreadPool>		mThreadPool;
+		std::shared_ptr<CinderNDIThreadPool::Job>	mWriteJob;
+		bool									mWriteFailed;	// only touched by the write job and by stop() once it ended
+		std::atomic_bool						mRecording;
+		std::atomic<uint64_t>					mNumFramesWritten, mNumFramesDropped, mNumBytesWritten;
+		std::chrono::steady_clock::time_point	mStartTime;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <atomic>
+
+#include "cinder/gl/Fbo.h"
+
+#include "CinderNDIReceiver.h"
+#include "CinderNDISender.h"
+#include "CinderNDIReadback.h"
+
+// Receives a source, optionally changes its video and sends it on under another name. Audio and metadata
+// are forwarded untouched with their original timecodes, and so is video without a processing stage.
+//
+// Frames are forwarded from inside the receiver's update(), the moment they are captured, by a sender
+// that leaves the clocking to the source so forwarding never blocks on the framerate. The CPU stage
+// edits the received buffer in place and that same buffer is sent, so nothing is copied or allocated per
+// frame. The GPU stage draws the received texture into an Fbo that is read back without stalling, which
+// delays its output by one frame. Without either stage, routing the source with a CinderNDIRouter avoids
+// decoding it at all.
+class CinderNDIRelay{
+	public:
+		// Changes the received frame in place. It must not change the size or format.
+		typedef std::function<void( NDIlib_video_frame_v2_t& videoFrame )> CpuStage;
+		// Draws the output for the received texture into the bound Fbo, which has the texture's size and a
+		// matching viewport and matrices. Runs on the thread calling update(), with its GL context current.
+		typedef std::function<void( const ci::gl::Texture2dRef& texture )> GpuStage;
+
+		CinderNDIRelay( const std::string& outputName );
+
+		// Starts relaying the source matching name, see CinderNDIReceiver::setup().
+		void setup( const std::string& sourceName, CinderNDISourceMatcher::Mode matchMode = CinderNDISourceMatcher::Mode::Exact );
+
+		// Only one stage is used, setting one clears the other. Set them before setup().
+		void setCpuStage( const CpuStage& stage );
+		void setGpuStage( const GpuStage& stage );
+
+		// Call once per app frame, or more often for sources faster than the app.
+		void update();
+
+		CinderNDIReceiver& getReceiver() { return mReceiver; }
+		CinderNDISender& getSender() { return mSender; }
+
+		uint64_t getNumForwardedFrames() const { return mNumForwardedFrames; }
+	private:
+		void onVideoFrame( const NDIlib_video_frame_v2_t& videoFrame );
+		void processGpuFrame();
+
+		CinderNDIReceiver					mReceiver;
+		CinderNDISender						mSender;
+		CpuStage							mCpuStage;
+		GpuStage							mGpuStage;
+
+		ci::gl::FboRef						mFbo;
+		std::unique_ptr<CinderNDIReadback>	mReadback;
+		bool								mHasGpuFrame;				// received by this update()
+		long long							mGpuFrameTimecode;
+		bool								mHasPendingReadback;		// drawn last update(), still in the readback
+		long long							mPendingReadbackTimecode;
+
+		std::atomic<uint64_t>				mNumForwardedFrames;
+};
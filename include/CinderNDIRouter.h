@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <memory>
+#include <vector>
+#include <mutex>
+
+#include <Processing.NDI.Lib.h>
+
+#include "CinderNDIDiscovery.h"
+#include "CinderNDISourceMatcher.h"
+
+// Publishes NDI sources under stable names that point at other sources on the network. Receivers of a
+// route connect straight to the source it points at, so nothing is received, decoded or sent again here
+// and a route costs no more than its announcement. Routes follow their source when it restarts at a new
+// address and come back when a source matching them reappears.
+class CinderNDIRouter{
+	public:
+		// groups are comma separated and apply to every route, empty means NDI's defaults.
+		CinderNDIRouter( const std::string& groups = "" );
+		~CinderNDIRouter();
+
+		// Sources come from a shared CinderNDIDiscovery unless a different one is set before the first route.
+		void setDiscovery( const std::shared_ptr<CinderNDIDiscovery>& discovery );
+
+		// Points the route called name at the source matching pattern, creating the route on first use. A
+		// pattern that matches nothing or several sources leaves the route empty until it matches exactly one.
+		bool route( const std::string& name, const std::string& pattern, CinderNDISourceMatcher::Mode matchMode = CinderNDISourceMatcher::Mode::Exact );
+		// Points the route at this source only, it is not looked up again when the source goes away.
+		bool route( const std::string& name, const CinderNDIDiscovery::Source& source );
+		// Keeps announcing the route but with nothing behind it, its receivers show no video.
+		void clear( const std::string& name );
+		// Stops announcing the route.
+		void remove( const std::string& name );
+
+		bool hasRoute( const std::string& name ) const;
+		// Full name of the source the route points at, empty while it points at nothing.
+		std::string getRoutedSourceName( const std::string& name ) const;
+		std::vector<std::string> getRouteNames() const;
+	private:
+		struct Route {
+			NDIlib_routing_instance_t		instance;
+			std::string						pattern;	// empty for routes to a fixed source
+			CinderNDISourceMatcher::Mode	matchMode;
+			CinderNDIDiscovery::Source		source;		// what the route points at, empty name for nothing
+		};
+
+		Route* createRoute( const std::string& name );		// or the existing one
+		void listen();
+		bool isOwnRoute( const CinderNDIDiscovery::Source& source ) const;
+		bool findSource( const Route& route, CinderNDIDiscovery::Source& source ) const;
+		void change( const std::string& name, Route& route, const CinderNDIDiscovery::Source& source );
+		void resolve( const std::string& name, Route& route );
+		void onSourceEvent( CinderNDIDiscovery::Event event, const CinderNDIDiscovery::Source& source );
+
+		std::string									mGroups;
+		std::string									mLocalMachine;
+		std::shared_ptr<CinderNDIDiscovery>			mDiscovery;
+		size_t										mDiscoveryListener;
+
+		mutable std::mutex							mRoutesMutex;	// discovery events arrive on its thread
+		std::map<std::string, Route>				mRoutes;
+};
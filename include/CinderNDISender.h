@@ -1,28 +1,162 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include "cinder/gl/Texture.h"
 #include "cinder/Xml.h"
 
 #include <Processing.NDI.Lib.h>
 
+#include "CinderNDIQueues.h"
+#include "CinderNDIThreadPool.h"
+#include "CinderNDIFrameClock.h"
+
 class CinderNDISender{
 	public:
-		CinderNDISender( const std::string name );
+		enum class AlphaMode {
+			Keep,			// send alpha exactly as it is in the Surface
+			Premultiply,	// the Surface holds straight alpha, send it premultiplied
+			Unpremultiply	// the Surface holds premultiplied alpha, send it straight
+		};
+
+		// clockVideo makes NDI block video sends to the framerate. Leave it off when the frames already
+		// arrive at their rate, for example when forwarding a received source.
+		CinderNDISender( const std::string name, bool clockVideo = true );
 		~CinderNDISender();
 
 		void setFramerate( int numerator, int denominator );
+		int getFramerateNumerator() const { return mFramerateNumerator; }
+		int getFramerateDenominator() const { return mFramerateDenominator; }
+
+		// Surfaces with alpha go out as BGRA/RGBA so fill and key travel in one stream, others as BGRX/RGBX.
+		void setAlphaMode( AlphaMode mode ) { mAlphaMode = mode; }
+		AlphaMode getAlphaMode() const { return mAlphaMode; }
+		// Sends BGRA Surfaces with alpha as UYVA (4:2:2 plus a full resolution alpha plane), about half the size of BGRA.
+		void setUYVAEnabled( bool enabled ) { mUYVAEnabled = enabled; }
+		bool isUYVAEnabled() const { return mUYVAEnabled; }
+
+		// Display aspect ratio sent with every frame, 0 means square pixels (xres / yres).
+		void setPictureAspectRatio( float aspectRatio ) { mPictureAspectRatio = aspectRatio; }
+		float getPictureAspectRatio() const { return mPictureAspectRatio; }
 
 		void sendSurface( ci::Surface& surface);
 		void sendSurface( ci::Surface&, long long timecode, bool async = false );
+		// Sends area of the Surface in place, without repacking it. With flipVertically the rows go out bottom to top
+		// through a negative line stride, which suits Surfaces read back from OpenGL.
+		void sendSurface( ci::Surface& surface, const ci::Area& area, long long timecode, bool flipVertically = false, bool async = false );
 		void sendSurfaceForceSync();
 
+		// Sends a caller-described frame, returns false when it was not submitted (nobody connected or an unchanged frame was skipped).
+		// With async the frame's buffer must stay valid until the next send call.
+		bool sendVideoFrame( const NDIlib_video_frame_v2_t& videoFrame, bool async = false );
+
 		void sendMetadata( const ci::XmlTree& metadataString );
 		void sendMetadata( const ci::XmlTree& metadataString, long long timecode );
+		// Forward frames unchanged, timecode included, for example ones received from another source.
+		// Return false when nobody is connected.
+		bool sendMetadataFrame( const NDIlib_metadata_frame_t& metadataFrame );
+		bool sendAudioFrame( const NDIlib_audio_frame_v2_t& audioFrame );
+
+		// Emits video from an internal clock at exactly the configured framerate. Sends then only copy the frame
+		// and return, each tick submits the newest copy or repeats the previous frame when the caller was late.
+		// Frames replaced before their tick came up are counted as dropped. Expects a single submitting thread.
+		void setPacingEnabled( bool enabled );
+		bool isPacingEnabled() const { return mPacingEnabled; }
+		uint64_t getNumRepeatedFrames() const { return mNumRepeatedFrames; }
+		uint64_t getNumDroppedFrames() const { return mNumDroppedFrames; }
+
+		// Skips frames whose content is identical to the last one sent, resending at most every keepAliveSeconds
+		// so receivers still see a live stream. Paced senders also stop repeating frames between keep-alives.
+		void setDeduplicationEnabled( bool enabled, double keepAliveSeconds = 1.0 );
+		bool isDeduplicationEnabled() const { return mDeduplicationEnabled; }
+		// Optional hint for the next frame that replaces hashing it: true forces a send, false marks it unchanged.
+		void setNextFrameChanged( bool changed ) { mNextFrameChanged = changed ? 1 : 0; }
+		uint64_t getNumDeduplicatedFrames() const { return mNumDeduplicatedFrames; }
 
 		std::string getName() { return mName; }
+		bool hasConnections() const;
+		// Receivers switch to the named source when this sender goes away and come back once it returns.
+		// An empty name clears it.
+		void setFailover( const std::string& sourceName );
+
+		// Tally as set by the connected receivers, polled on every send and by shouldSendFrame(). The callback
+		// runs on the thread that noticed the change.
+		bool isOnProgram() const { return mOnProgram; }
+		bool isOnPreview() const { return mOnPreview; }
+		typedef std::function<void( bool onProgram, bool onPreview )> TallyCallback;
+		void setTallyCallback( const TallyCallback& callback );
+		// Polls the tally, waiting up to timeoutMs for a change, and returns true when it changed.
+		bool updateTally( uint32_t timeoutMs = 0 );
+
+		// Work saved while receivers are connected but the output is neither on program nor on preview.
+		// Receivers that never set a tally count as not watching, so the default policy changes nothing.
+		struct IdlePolicy {
+			int		frameInterval;		// sends every frameInterval-th frame of the configured framerate
+			bool	halfResolution;		// sends Surfaces at half width and height
+			bool	skipConversion;		// sends Surfaces as they are, without alpha conversion or UYVA
+			IdlePolicy() : frameInterval{ 1 }, halfResolution{ false }, skipConversion{ false } {}
+		};
+		void setIdlePolicy( const IdlePolicy& policy );
+		IdlePolicy getIdlePolicy() const;
+		bool isIdle() const { return ! mOnProgram && ! mOnPreview; }
+		// False when nobody is connected or the idle policy skips this frame. Call it before rendering or reading
+		// back a frame to skip that work as well, the send calls check it again anyway.
+		bool shouldSendFrame();
+
+		// Bytes per row of a tightly packed frame, 0 for unsupported formats. UYVY and UYVA rows hold whole pixel
+		// pairs, so an odd width is rounded up.
+		static int calcLineStride( int width, NDIlib_FourCC_type_e fourCC );
 	private:
-		int						mFramerateNumerator, mFramerateDenominator;
+		struct PacedFrame {
+			NDIlib_video_frame_v2_t		videoFrame;
+			std::vector<uint8_t>		data;
+			std::string					metadata;
+		};
+
+		bool submitVideoFrame( const NDIlib_video_frame_v2_t& videoFrame, bool async );
+		bool isDuplicateFrame( const NDIlib_video_frame_v2_t& videoFrame );
+		bool isKeepAliveDue() const;
+		bool isIdleThrottled() const;
+		void copyPacedFrame( const NDIlib_video_frame_v2_t& videoFrame );
+		CinderNDIThreadPool::Clock::time_point pace();
+
+		std::atomic_int			mFramerateNumerator, mFramerateDenominator;
 		NDIlib_send_instance_t	mNdiSender;
 		std::string				mName;
+
+		std::shared_ptr<CinderNDIThreadPool>		mThreadPool;
+		std::shared_ptr<CinderNDIThreadPool::Job>	mPacingJob;
+		CinderNDIFrameClock				mPacingClock;
+		int								mPacingNumerator, mPacingDenominator;
+		bool							mHasInFlightFrame;
+		std::atomic_bool				mPacingEnabled;
+		CinderNDITripleBuffer<PacedFrame>	mPacedFrames;
+		PacedFrame						mInFlightFrame;		// pacing job side, NDI reads it until the next send
+		std::atomic<uint64_t>			mNumRepeatedFrames, mNumDroppedFrames;
+
+		std::atomic_bool				mDeduplicationEnabled;
+		std::atomic_int					mNextFrameChanged;		// -1 unknown, 0 unchanged, 1 changed
+		std::atomic<std::chrono::steady_clock::rep>	mKeepAliveInterval;		// steady_clock ticks, read by the pacing job
+		std::atomic<std::chrono::steady_clock::rep>	mLastSendTime;			// steady_clock ticks of the last submitted frame
+		uint64_t						mLastFrameHash;
+		std::atomic<uint64_t>			mNumDeduplicatedFrames;
+
+		float							mPictureAspectRatio;
+		AlphaMode						mAlphaMode;
+		bool							mUYVAEnabled;
+		std::vector<uint8_t>			mAlphaScratch;
+		std::vector<uint8_t>			mConvertedFrames[2];	// alternate so an async send can still read the previous one
+		size_t							mConvertedFrameIndex;
+		std::vector<uint8_t>			mScaleScratch;
+
+		std::atomic_bool				mOnProgram, mOnPreview;
+		std::mutex						mTallyMutex;
+		TallyCallback					mTallyCallback;
+		std::atomic_int					mIdleFrameInterval;
+		std::atomic_bool				mIdleHalfResolution, mIdleSkipConversion;
 };
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "cinder/Surface.h"
+#include "CinderNDISender.h"
+
+// Publishes one source frame to several NDI outputs, each with its own crop, size and FourCC.
+// The source is read back once by the caller; outputs sharing a crop and size share the scaled
+// image, outputs that also share a FourCC share the conversion, and crops without scaling are
+// sent straight out of the source without a copy. Work for outputs nobody is connected to is skipped.
+class CinderNDISenderGroup{
+	public:
+		struct Output {
+			Output( const std::string& name, const ci::Area& crop = ci::Area( 0, 0, 0, 0 ), const ci::ivec2& size = ci::ivec2( 0, 0 ), NDIlib_FourCC_type_e fourCC = NDIlib_FourCC_type_BGRX )
+				: name{ name }, crop{ crop }, size{ size }, fourCC{ fourCC } {}
+
+			std::string				name;
+			ci::Area				crop;		// source area, empty for the whole source; outputs skip frames it doesn't overlap
+			ci::ivec2				size;		// output resolution, zero keeps the crop size
+			NDIlib_FourCC_type_e	fourCC;		// BGRX, BGRA, UYVY or UYVA, anything else falls back to BGRX
+		};
+
+		CinderNDISenderGroup();
+
+		size_t addOutput( const Output& output );
+		size_t getNumOutputs() const { return mOutputs.size(); }
+		CinderNDISender& getSender( size_t index ) { return *mOutputs[index].sender; }
+
+		void setFramerate( int numerator, int denominator );
+
+		// The source has to be BGRA or BGRX ordered. Returns once every output has finished with the frame.
+		void sendSurface( const ci::Surface8u& surface, long long timecode = NDIlib_send_timecode_synthesize );
+	private:
+		// Scaled BGRA image for one crop/size pair, or a view into the source when no scaling is needed.
+		struct Stage {
+			ci::Area				crop;
+			ci::ivec2				size;
+			std::vector<uint8_t>	data;
+			const uint8_t*			pixels;
+			ptrdiff_t				stride;
+			int						width, height;	// resolved for the current source
+			bool					needed;
+		};
+
+		// Stage converted to a non BGRA FourCC.
+		struct Conversion {
+			size_t					stage;
+			NDIlib_FourCC_type_e	fourCC;
+			std::vector<uint8_t>	data;
+			int						stride;
+			bool					needed;
+		};
+
+		struct OutputState {
+			OutputState( const Output& output ) : output{ output }, stage{ 0 }, conversion{ -1 } {}
+
+			Output								output;
+			std::unique_ptr<CinderNDISender>	sender;
+			size_t								stage;
+			int									conversion;		// -1 when the stage is sent directly
+		};
+
+		std::vector<Stage>			mStages;
+		std::vector<Conversion>		mConversions;
+		std::vector<OutputState>	mOutputs;
+};
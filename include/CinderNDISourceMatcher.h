@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+#include "CinderNDIDiscovery.h"
+
+// Finds sources by name without the surprises of substring matching, where "cam1" also hits "cam10".
+// update() indexes a snapshot of the source list, so exact, full name and URL lookups are hash lookups
+// and prefixes a range in a sorted map; only regular expressions look at every source. Lookups that
+// match more than one source report that instead of picking one.
+class CinderNDISourceMatcher{
+	public:
+		enum class Mode {
+			Exact,				// the stream name, "cam1" in "STUDIO-PC (cam1)", on whatever machine
+			MachineAndName,		// the full "MACHINE (stream)" name, machine names ignore case
+			Prefix,				// the start of the full name, "STUDIO-PC (" picks a machine
+			Regex,				// ECMAScript expression matching the whole full name
+			Url,				// "host:port", or just the host to match any port on it
+			Contains			// any part of the full name, how receivers used to match
+		};
+
+		enum class Result {
+			Found,
+			NotFound,
+			Ambiguous
+		};
+
+		void update( const std::vector<CinderNDIDiscovery::Source>& sources );
+		const std::vector<CinderNDIDiscovery::Source>& getSources() const { return mSources; }
+
+		Result find( Mode mode, const std::string& pattern, CinderNDIDiscovery::Source& source ) const;
+		// Index of the single matching source in getSources(), -1 when there is none or several.
+		int findIndex( Mode mode, const std::string& pattern ) const;
+		std::vector<CinderNDIDiscovery::Source> findAll( Mode mode, const std::string& pattern ) const;
+
+		// Tests one source, for filtering discovery events without an index.
+		static bool matches( Mode mode, const std::string& pattern, const CinderNDIDiscovery::Source& source );
+		// Splits "MACHINE (stream)", returns false for names without the parentheses.
+		static bool splitName( const std::string& fullName, std::string& machine, std::string& stream );
+		// Machine part of the names this machine announces its sources under, in lower case.
+		static std::string getLocalMachine();
+	private:
+		void findIndices( Mode mode, const std::string& pattern, std::vector<size_t>& indices, size_t maxCount ) const;
+		static std::string normalizeFullName( const std::string& fullName );
+		static std::string getHost( const std::string& url );
+
+		std::vector<CinderNDIDiscovery::Source>				mSources;
+		std::unordered_multimap<std::string, size_t>		mByStream;
+		std::unordered_multimap<std::string, size_t>		mByFullName;	// machine part in lower case
+		std::unordered_multimap<std::string, size_t>		mByUrl;
+		std::unordered_multimap<std::string, size_t>		mByHost;
+		std::multimap<std::string, size_t>					mSorted;		// full names for prefix ranges
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <Processing.NDI.Lib.h>
+
+class CinderNDISender;
+
+// Generates measurable test frames on the CPU. Every frame carries a marker band along its top edge
+// that encodes the frame counter and the send time in large black and white blocks, which survive
+// NDI compression and 4:2:2 subsampling, and the same values as frame metadata. The pattern below the
+// band exercises the encoder: static bars and ramps, an animated zone plate or a moving edge.
+// CinderNDITestPatternAnalyzer reads both back on the receiving side.
+class CinderNDITestPattern{
+	public:
+		enum class Pattern {
+			Bars,		// 75% color bars
+			Ramp,		// horizontal luma ramp
+			ZonePlate,	// circular zone plate with a phase that advances every frame
+			MovingEdge	// sharp vertical edge crossing the frame
+		};
+
+		static const int kMarkerBlockSize = 8;
+		static const int kMarkerBits = 152;		// 8 sync, 64 counter, 64 timestamp, 16 check
+
+		CinderNDITestPattern( int width, int height, Pattern pattern = Pattern::Bars );
+
+		void setPattern( Pattern pattern );
+		Pattern getPattern() const { return mPattern; }
+		int getWidth() const { return mWidth; }
+		int getHeight() const { return mHeight; }
+
+		// Draws frame frameIndex as BGRX into dst, marker included.
+		void render( uint64_t frameIndex, uint64_t timestamp, uint8_t* dst, ptrdiff_t stride );
+		// Renders the next frame stamped with the current time and sends it with matching metadata.
+		// Returns false when the sender didn't take it, the frame is then repeated with a fresh stamp.
+		bool send( CinderNDISender& sender, bool async = false );
+		uint64_t getFrameIndex() const { return mFrameIndex; }
+
+		// Microseconds on the system clock, so latencies across hosts are as good as their clock sync.
+		static uint64_t now();
+		// Rows covered by the marker band for a frame of this width.
+		static int calcMarkerHeight( int width );
+		static void stampMarker( uint8_t* bgra, ptrdiff_t stride, int width, uint64_t counter, uint64_t timestamp );
+		// Decodes the marker of a BGRA, BGRX or UYVY frame, returns false when it isn't there or damaged.
+		static bool readMarker( const NDIlib_video_frame_v2_t& videoFrame, uint64_t& counter, uint64_t& timestamp );
+	private:
+		void renderRow( std::vector<uint8_t>& row, uint64_t frameIndex );
+		void renderZonePlate( uint64_t frameIndex, uint8_t* dst, ptrdiff_t stride, int firstRow );
+
+		int						mWidth, mHeight;
+		Pattern					mPattern;
+		std::vector<uint8_t>	mRow;				// the single row repeated by row based patterns
+		std::vector<uint32_t>	mZoneTermsX;		// per column x^2 term of the zone plate phase
+		uint8_t					mSine[1024];
+
+		std::vector<uint8_t>	mBuffers[2];		// alternate so an async send can still read the previous frame
+		std::string				mMetadata[2];
+		size_t					mBufferIndex;
+		uint64_t				mFrameIndex;
+};
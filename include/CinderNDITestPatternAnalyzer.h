@@ -0,0 +1,39 @@
+#pragma once
+
+#include <mutex>
+#include <cstdint>
+
+#include <Processing.NDI.Lib.h>
+
+// Measures a stream of CinderNDITestPattern frames on the receiving side. Feed it every received video
+// frame, for example from CinderNDIReceiver::setVideoFrameCallback(). Counters and timestamps are
+// taken from the pixel marker and fall back to the frame metadata when the marker can't be read.
+class CinderNDITestPatternAnalyzer{
+	public:
+		struct Stats {
+			uint64_t	framesAnalyzed;
+			uint64_t	framesDecoded;		// frames that carried a readable counter
+			uint64_t	framesDropped;		// counters skipped between consecutive frames
+			uint64_t	framesDuplicated;	// same counter as the previous frame
+			uint64_t	framesReordered;	// counter lower than the previous frame
+			uint64_t	markerMismatches;	// pixel marker and metadata disagree
+			double		meanLatency;		// seconds from the sender's stamp to analyze()
+			double		minLatency, maxLatency;
+		};
+
+		CinderNDITestPatternAnalyzer();
+
+		// Returns false when the frame carried no test pattern information.
+		bool analyze( const NDIlib_video_frame_v2_t& videoFrame );
+		Stats getStats() const;
+		void reset();
+	private:
+		static bool readMetadata( const char* metadata, uint64_t& counter, uint64_t& timestamp );
+
+		mutable std::mutex	mMutex;
+		Stats				mStats;
+		bool				mHasLastCounter;
+		uint64_t			mLastCounter;
+		double				mLatencyTotal;
+		uint64_t			mNumLatencies;
+};
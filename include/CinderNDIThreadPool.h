@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+// Runs the background work of all NDI instances on a fixed set of threads instead of one or more
+// threads per instance. Work comes as jobs: a step function that is called again and again, never on
+// two threads at once, and returns when it wants to run next. Ready jobs are spread over per-thread
+// queues and idle threads steal from busy ones. Jobs that are waiting cost no thread at all.
+// Jobs that wait inside the NDI SDK, such as capture and discovery, get a thread of a small blocking
+// lane instead, so they wake the moment a frame or change arrives rather than polling.
+class CinderNDIThreadPool{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		enum class Priority {
+			Normal,
+			High		// above normal, for pools that pace or capture video (Windows only)
+		};
+
+		struct Options {
+			int			numThreads;				// 0 for one per core
+			int			numBlockingThreads;		// most blocking jobs running at once, more fall back to polling
+			bool		pinThreads;				// runs each worker thread on its own core
+			Priority	priority;
+			Options() : numThreads{ 0 }, numBlockingThreads{ 8 }, pinThreads{ false }, priority{ Priority::Normal } {}
+		};
+
+		// Returns when the step wants to run again, a time already passed to run as soon as possible or
+		// kStop to end the job.
+		typedef std::function<Clock::time_point()> Step;
+		static const Clock::time_point kStop;
+		// A step that may block inside the SDK when mayBlock is true, see startBlockingJob().
+		typedef std::function<Clock::time_point( bool mayBlock )> BlockingStep;
+
+		class Job;
+
+		struct JobStats {
+			std::string		name;
+			uint64_t		numRuns;
+			double			totalSeconds, maxSeconds;	// time spent in the step
+			double			maxLateness;				// seconds between when a step wanted to run and when it did
+		};
+
+		CinderNDIThreadPool( const Options& options = Options() );
+		~CinderNDIThreadPool();
+
+		// The shared pool, created on first use with the default options and released with its last user.
+		static std::shared_ptr<CinderNDIThreadPool> getDefault();
+		// Takes effect the next time the shared pool is created.
+		static void setDefaultOptions( const Options& options );
+
+		// preciseTiming raises the system timer resolution to 1 ms while the job exists, for jobs that pace
+		// output with a CinderNDIFrameClock and can't afford Windows' default 15.6 ms wake ups.
+		std::shared_ptr<Job> startJob( const std::string& name, const Step& step, bool preciseTiming = false );
+		// Runs the job on a blocking lane thread of its own, where step( true ) may wait inside the SDK for
+		// up to a few hundred milliseconds; stopJob() waits for that wait to end. Once numBlockingThreads
+		// jobs are running the job goes to the workers instead and gets step( false ), which must not block.
+		std::shared_ptr<Job> startBlockingJob( const std::string& name, const BlockingStep& step );
+		// Waits for a running step to return, the job never runs again afterwards. Must not be called from
+		// the job's own step.
+		void stopJob( const std::shared_ptr<Job>& job );
+		// Runs task once.
+		void submit( const std::string& name, const std::function<void()>& task );
+
+		size_t getNumThreads() const { return mWorkers.size(); }
+		std::vector<JobStats> getJobStats();
+	private:
+		struct Worker {
+			std::thread							thread;
+			std::mutex							mutex;
+			std::deque<std::shared_ptr<Job>>	queue;
+		};
+		struct Lane {
+			std::thread				thread;		// started on first use
+			std::shared_ptr<Job>	job;		// null while the lane is free
+		};
+		struct Timer {
+			Clock::time_point		time;
+			std::shared_ptr<Job>	job;
+			bool operator<( const Timer& other ) const { return time > other.time; }
+		};
+
+		std::shared_ptr<Job> createJob( const std::string& name, const Step& step );
+		void threadedWork( size_t index );
+		void threadedBlocking( size_t index );
+		bool popJob( size_t index, std::shared_ptr<Job>& job );
+		void moveDueTimers( size_t index );
+		void run( size_t index, const std::shared_ptr<Job>& job );
+		bool runStep( const std::shared_ptr<Job>& job, Clock::time_point& next );
+		static void releasePreciseTiming( Job& job );
+		void enqueue( size_t index, const std::shared_ptr<Job>& job );
+		void configureThread( size_t index, bool pin );
+
+		Options									mOptions;
+		std::vector<std::unique_ptr<Worker>>	mWorkers;
+		std::atomic<size_t>						mNextWorker;
+		std::atomic<size_t>						mNumQueued;
+
+		std::mutex								mMutex;		// timers and sleeping
+		std::condition_variable					mCondition;
+		std::priority_queue<Timer>				mTimers;
+		std::atomic_bool						mQuit;
+
+		std::mutex								mLanesMutex;
+		std::condition_variable					mLanesCondition;
+		std::vector<std::unique_ptr<Lane>>		mLanes;
+
+		std::mutex								mJobsMutex;
+		std::vector<std::weak_ptr<Job>>			mJobs;
+};
+
+class CinderNDIThreadPool::Job{
+	public:
+		Job( const std::string& name, const Step& step );
+		const std::string& getName() const { return mName; }
+	private:
+		friend class CinderNDIThreadPool;
+
+		std::string				mName;
+		std::mutex				mMutex;		// held while the step runs
+		Step					mStep;
+		std::atomic_bool		mStopped;
+		std::atomic_bool		mPreciseTiming;		// holds a raised timer resolution
+		Clock::time_point		mDueTime;
+
+		std::atomic<uint64_t>	mNumRuns;
+		std::atomic<uint64_t>	mTotalNanos, mMaxNanos, mMaxLatenessNanos;
+};
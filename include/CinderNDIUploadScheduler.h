@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class CinderNDIReceiver;
+
+// Caps the bytes that all receivers sharing it upload to the GPU per render frame. Receivers join
+// through CinderNDIReceiver::setUploadScheduler(), video walls through CinderNDIVideoWall::setUploadScheduler(),
+// and take their priority from their usage. Calling
+// update() once per frame instead of updating the receivers one by one lets program sources spend the
+// budget first; frames over the budget are deferred, keeping only the newest, or dropped for background
+// sources. The first upload of a frame is always allowed, so a single frame larger than the budget
+// still goes through.
+class CinderNDIUploadScheduler{
+	public:
+		enum class Priority {
+			Program,	// on air
+			Preview,	// visible or on a preview tile
+			Background	// not shown, frames over the budget are dropped
+		};
+
+		enum class Decision {
+			Upload,
+			Defer,		// keep the frame and ask again next frame
+			Drop
+		};
+
+		struct Stats {
+			uint64_t	framesUploaded;
+			uint64_t	framesDeferred;		// held back for a later frame, once per frame a frame waits
+			uint64_t	framesReplaced;		// deferred frames a newer one replaced before they were uploaded
+			uint64_t	framesDropped;
+			uint64_t	bytesUploaded;
+		};
+
+		// bytesPerFrame = 0 leaves the uploads unlimited, only the stats are collected.
+		CinderNDIUploadScheduler( size_t bytesPerFrame = 0 );
+
+		void setBudget( size_t bytesPerFrame ) { mBudget = bytesPerFrame; }
+		size_t getBudget() const { return mBudget; }
+
+		// Starts a new render frame and updates every registered receiver, highest priority first.
+		void update();
+		// Starts a new render frame for apps that update the receivers themselves.
+		void beginFrame();
+
+		// Called by the receivers for every frame they want to upload, counts it when allowed.
+		Decision schedule( size_t bytes, Priority priority );
+		// Called by the receivers when a newer frame replaces one they deferred.
+		void countReplaced( Priority priority ) { ++mStats[(int)priority].framesReplaced; }
+
+		Stats getStats( Priority priority ) const { return mStats[(int)priority]; }
+		Stats getTotalStats() const;
+		void resetStats();
+		size_t getNumBytesThisFrame() const { return mNumBytesThisFrame; }
+		size_t getNumBytesLastFrame() const { return mNumBytesLastFrame; }
+		size_t getPeakBytesPerFrame() const { return mPeakBytesPerFrame; }
+		size_t getNumReceivers() const { return mReceivers.size(); }
+	private:
+		friend class CinderNDIReceiver;
+		void addReceiver( CinderNDIReceiver* receiver );
+		void removeReceiver( CinderNDIReceiver* receiver );
+
+		std::vector<CinderNDIReceiver*>	mReceivers;
+		size_t							mBudget;
+		size_t							mNumBytesThisFrame;
+		size_t							mNumBytesLastFrame;
+		size_t							mPeakBytesPerFrame;
+		Stats							mStats[3];
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/GlslProg.h"
+
+#include "CinderNDIReceiver.h"
+
+// Receives many sources into the layers of one texture array and draws the whole wall with a single
+// instanced draw call. Frames are written into their layer in place instead of creating a texture per
+// frame. Uploads go through a CinderNDIUploadScheduler, each tile with the priority of its receiver's
+// usage: frames over the budget are kept back (only the newest per source) and go first on the next
+// update, or are dropped for hidden tiles.
+class CinderNDIVideoWall{
+	public:
+		// Every source gets a layer of layerWidth x layerHeight, larger frames are cropped to it. All layers
+		// are allocated on the first upload, 16 HD layers take about 130 MB of video memory.
+		CinderNDIVideoWall( int layerWidth = 1920, int layerHeight = 1080, size_t maxSources = 16 );
+
+		// Connects a new receiver to the named sender, returns the index of its tile or -1 when the wall is full.
+		int addSource( const std::string& senderName );
+		size_t getNumSources() const { return mTiles.size(); }
+		CinderNDIReceiver& getReceiver( size_t index ) { return *mTiles[index].receiver; }
+
+		// Window space rectangle the tile is drawn into.
+		void setTileRect( size_t index, const ci::Rectf& rect ) { mTiles[index].rect = rect; }
+		const ci::Rectf& getTileRect( size_t index ) const { return mTiles[index].rect; }
+		// Arranges all tiles in a grid over bounds, columns = 0 picks a near square grid.
+		void layoutGrid( const ci::Rectf& bounds, int columns = 0 );
+
+		// The wall starts with a scheduler of its own and starts its frames in update(). A scheduler shared
+		// with other walls or receivers is left to the app to start, with update() or beginFrame() before
+		// the wall updates. Null is ignored.
+		void setUploadScheduler( const std::shared_ptr<CinderNDIUploadScheduler>& scheduler );
+		const std::shared_ptr<CinderNDIUploadScheduler>& getUploadScheduler() const { return mUploadScheduler; }
+		// Sets the budget of the current scheduler, 0 uploads every frame as it arrives.
+		void setUploadBudget( size_t bytesPerUpdate ) { mUploadScheduler->setBudget( bytesPerUpdate ); }
+		size_t getUploadBudget() const { return mUploadScheduler->getBudget(); }
+
+		// Captures from all receivers and uploads within the budget.
+		void update();
+		void draw();
+
+		size_t getNumBytesUploaded() const { return mNumBytesUploaded; }	// during the last update
+		size_t getNumDeferredFrames() const;								// waiting for budget right now
+		uint64_t getNumReplacedFrames() const { return mNumReplacedFrames; }	// deferred frames overwritten by a newer one
+	private:
+		struct Tile {
+			std::unique_ptr<CinderNDIReceiver>	receiver;
+			ci::Rectf							rect;
+			int									width, height;		// of the content in the layer
+			bool								hasContent;
+			std::vector<uint8_t>				pending;			// newest frame that missed the budget
+			int									pendingWidth, pendingHeight;
+			bool								hasPending;
+		};
+
+		void onVideoFrame( size_t index, const NDIlib_video_frame_v2_t& videoFrame );
+		void upload( size_t index, const uint8_t* data, int stride, int width, int height );
+		void drawTiles( const ci::vec4* rects, const ci::vec4* regions, int count );
+
+		int						mLayerWidth, mLayerHeight;
+		size_t					mMaxSources;
+		std::vector<Tile>		mTiles;
+		ci::gl::Texture3dRef	mLayers;
+		ci::gl::GlslProgRef		mProg;
+		ci::gl::VaoRef			mVao;
+
+		std::shared_ptr<CinderNDIUploadScheduler>	mUploadScheduler;
+		bool					mOwnsUploadScheduler;
+		size_t					mNumBytesUploaded;
+		size_t					mNextTile;		// round robin start for the deferred uploads
+		uint64_t				mNumReplacedFrames;
+};
@@ -15,6 +15,26 @@ if( NOT TARGET Cinder-NDI )
 	
 	add_library( Cinder-NDI "${CINDER_NDI_SOURCE_PATH}/CinderNDIReceiver.cpp"
 							"${CINDER_NDI_SOURCE_PATH}/CinderNDISender.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIHeadlessSender.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIFrameClock.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIFrameHash.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIReadback.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIConvert.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDISenderGroup.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIDownscaler.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIDeinterlacer.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIRecorder.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIFrameFile.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDILoadGenerator.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDITestPattern.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDITestPatternAnalyzer.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIVideoWall.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIUploadScheduler.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIDiscovery.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDISourceMatcher.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIRouter.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIRelay.cpp"
+							"${CINDER_NDI_SOURCE_PATH}/CinderNDIThreadPool.cpp"
 	)
 
 	target_include_directories( Cinder-NDI PUBLIC "${CINDER_NDI_INCLUDE_PATH}" "${NDI_INCLUDE_PATH}" )
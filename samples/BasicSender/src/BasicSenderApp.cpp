@@ -3,6 +3,7 @@
 #include "cinder/gl/gl.h"
 #include "cinder/gl/Texture.h"
 #include "CinderNDISender.h"
+#include "CinderNDIReadback.h"
 
 using namespace ci;
 using namespace ci::app;
@@ -15,60 +16,52 @@ class BasicSenderApp : public App {
 	void draw() override;
   private:
 	CinderNDISender			mSender;
-	ci::SurfaceRef 			mSurface;
-	uint8_t					mIndexNew, mIndexOld;
-	gl::FboRef				mFbo[2];
-	gl::PboRef				mPbo[2];
+	CinderNDIReadback		mReadback;
+	gl::FboRef				mFbo;
+	float					mBarWidth;
 };
 
 BasicSenderApp::BasicSenderApp()
 : mSender( "test-cinder-video" )
-, mIndexNew{ 0 }
-, mIndexOld{ 1 }
+, mReadback( getWindowWidth(), getWindowHeight() )
+, mBarWidth{ 0.0f }
 {
-	mFbo[0] = gl::Fbo::create( getWindowWidth(), getWindowHeight(), false );
-	mFbo[1] = gl::Fbo::create( getWindowWidth(), getWindowHeight(), false );
-
-	mSurface = ci::Surface::create( getWindowWidth(), getWindowHeight(), true, SurfaceChannelOrder::BGRA );
-
-	mPbo[0] = gl::Pbo::create( GL_PIXEL_PACK_BUFFER, getWindowWidth() * getWindowHeight() * 4, 0, GL_STREAM_READ );
-	mPbo[1] = gl::Pbo::create( GL_PIXEL_PACK_BUFFER, getWindowWidth() * getWindowHeight() * 4, 0, GL_STREAM_READ );
+	mFbo = gl::Fbo::create( getWindowWidth(), getWindowHeight(), false );
+	mSender.setDeduplicationEnabled( true );
 }
 
 void BasicSenderApp::update()
 {
 	getWindow()->setTitle( "CinderNDI-Sender - " + std::to_string( (int) getAverageFps() ) + " FPS" );
 
-	if( mSurface )
-	{
-		gl::ScopedFramebuffer sFbo( mFbo[mIndexOld] );
-		gl::ScopedBuffer scopedPbo( mPbo[mIndexNew] );
-		
-		gl::readBuffer( GL_COLOR_ATTACHMENT0 );
-		gl::readPixels( 0, 0, mFbo[mIndexOld]->getWidth(), mFbo[mIndexOld]->getHeight(), GL_RGBA, GL_UNSIGNED_BYTE, 0 );
-		mPbo[mIndexOld]->getBufferSubData( 0, mFbo[mIndexOld]->getWidth() * mFbo[mIndexOld]->getHeight() * 4, mSurface->getData() ); 
-	}
-
+	float barWidth = float( 0.5f * (glm::sin( getElapsedSeconds() ) + 1.0f) ) * app::getWindowWidth();
 	{
-		gl::ScopedFramebuffer sFbo( mFbo[mIndexNew] );
-		gl::ScopedViewport sVp( 0, 0, mFbo[mIndexNew]->getWidth(), mFbo[mIndexNew]->getHeight() );
+		gl::ScopedFramebuffer sFbo( mFbo );
+		gl::ScopedViewport sVp( 0, 0, mFbo->getWidth(), mFbo->getHeight() );
 		gl::clear( ColorA::black() );
 		gl::ScopedColor pushCol{ ColorA::white() };
-		gl::drawSolidRect( Rectf{ 0,0, float( 0.5f * (glm::sin( getElapsedSeconds() ) + 1.0f) ) * app::getWindowWidth(), float( app::getWindowHeight() ) } );
+		gl::drawSolidRect( Rectf{ 0,0, barWidth, float( app::getWindowHeight() ) } );
 	}
 
+	// only the columns between the old and new bar edge changed.
+	mReadback.addDirtyArea( Area( (int)glm::min( barWidth, mBarWidth ), 0, (int)glm::ceil( glm::max( barWidth, mBarWidth ) ) + 1, mFbo->getHeight() ) );
+	mBarWidth = barWidth;
+	bool changed = mReadback.readback( mFbo );
+
 	long long timecode = app::getElapsedFrames();
 
 	XmlTree msg{ "ci_meta", "test string" };
 	mSender.sendMetadata( msg, timecode );
-	mSender.sendSurface( *mSurface, timecode );
+	mSender.setNextFrameChanged( changed );
+	// the read back rows are bottom-up, flip them on the way out instead of copying.
+	auto surface = mReadback.getSurface();
+	mSender.sendSurface( *surface, surface->getBounds(), timecode, true );
 }
 
 void BasicSenderApp::draw()
 {
 	gl::clear( ColorA::black() );
-	gl::draw( mFbo[mIndexNew]->getColorTexture() );
-	std::swap( mIndexNew, mIndexOld );
+	gl::draw( mFbo->getColorTexture() );
 }
 
 void prepareSettings( BasicSenderApp::Settings* settings )
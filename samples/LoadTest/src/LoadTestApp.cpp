@@ -0,0 +1,90 @@
+#include "cinder/app/App.h"
+#include "cinder/app/RendererGl.h"
+#include "cinder/gl/gl.h"
+#include "cinder/Log.h"
+
+#include <sstream>
+
+#include "CinderNDILoadGenerator.h"
+
+using namespace ci;
+using namespace ci::app;
+
+// Usage: LoadTest [number of senders] [frame file to replay]
+class LoadTestApp : public App {
+  public:
+	LoadTestApp();
+	void setup() override;
+	void update() override;
+	void draw() override;
+	void keyDown( KeyEvent event ) override;
+
+  private:
+	CinderNDILoadGenerator	mGenerator;
+	std::string				mReport;
+};
+
+LoadTestApp::LoadTestApp()
+	: mGenerator{ 1920, 1080, NDIlib_FourCC_type_UYVY }
+{
+}
+
+void LoadTestApp::setup()
+{
+	size_t numSenders = 8;
+	const auto& args = getCommandLineArgs();
+	if( args.size() > 1 ) {
+		numSenders = std::max( 1, std::atoi( args[1].c_str() ) );
+	}
+	if( args.size() > 2 ) {
+		mGenerator.setReplayFile( args[2] );
+	}
+
+	mGenerator.setFramerate( 60000, 1001 );
+	mGenerator.addSenders( "cinder-load-test", numSenders );
+	mGenerator.start();
+}
+
+void LoadTestApp::update()
+{
+	if( getElapsedFrames() % 30 != 0 ) {
+		return;
+	}
+
+	auto total = mGenerator.getTotalStats();
+	std::stringstream report;
+	report << mGenerator.getNumSenders() << " senders, " << total.ticksMissed << " ticks missed, mean send " << total.meanSendLatency * 1000.0 << " ms, max " << total.maxSendLatency * 1000.0 << " ms\n";
+	for( size_t i = 0; i < mGenerator.getNumSenders(); ++i ) {
+		auto stats = mGenerator.getStats( i );
+		report << mGenerator.getSender( i ).getName() << ": " << stats.framesSent << " frames, " << stats.framesPerSecond << " fps, mean send " << stats.meanSendLatency * 1000.0 << " ms\n";
+	}
+	mReport = report.str();
+}
+
+void LoadTestApp::draw()
+{
+	gl::clear( ColorA::black() );
+
+	vec2 position( 10.0f, 10.0f );
+	std::stringstream lines( mReport );
+	std::string line;
+	while( std::getline( lines, line ) ) {
+		gl::drawString( line, position );
+		position.y += 16.0f;
+	}
+}
+
+void LoadTestApp::keyDown( KeyEvent event )
+{
+	// space pauses and resumes the load, restarting the statistics.
+	if( event.getCode() == KeyEvent::KEY_SPACE ) {
+		if( mGenerator.isRunning() ) {
+			mGenerator.stop();
+		}
+		else {
+			mGenerator.start();
+		}
+	}
+}
+
+CINDER_APP( LoadTestApp, RendererGl )
@@ -0,0 +1,223 @@
+#include "CinderNDIConvert.h"
+
+#include <algorithm>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define CINDER_NDI_CONVERT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+void boxScale( const uint8_t* src, ptrdiff_t srcStride, uint8_t* dst, ptrdiff_t dstStride, int dstWidth, int dstHeight, int factorX, int factorY )
+{
+	const uint32_t count = factorX * factorY;
+	const uint32_t rounding = count / 2;
+	for( int y = 0; y < dstHeight; ++y ) {
+		const uint8_t* srcRow = src + (ptrdiff_t)y * factorY * srcStride;
+		uint8_t* dstRow = dst + (ptrdiff_t)y * dstStride;
+		for( int x = 0; x < dstWidth; ++x ) {
+			uint32_t sum[4] = { 0, 0, 0, 0 };
+			for( int fy = 0; fy < factorY; ++fy ) {
+				const uint8_t* p = srcRow + fy * srcStride + x * factorX * 4;
+				for( int fx = 0; fx < factorX; ++fx, p += 4 ) {
+					sum[0] += p[0];
+					sum[1] += p[1];
+					sum[2] += p[2];
+					sum[3] += p[3];
+				}
+			}
+			for( int c = 0; c < 4; ++c ) {
+				dstRow[x * 4 + c] = (uint8_t)( ( sum[c] + rounding ) / count );
+			}
+		}
+	}
+}
+
+void bilinearScale( const uint8_t* src, ptrdiff_t srcStride, int srcWidth, int srcHeight, uint8_t* dst, ptrdiff_t dstStride, int dstWidth, int dstHeight )
+{
+	// 16.16 fixed point, sampling pixel centers.
+	const int64_t stepX = ( (int64_t)srcWidth << 16 ) / dstWidth;
+	const int64_t stepY = ( (int64_t)srcHeight << 16 ) / dstHeight;
+	for( int y = 0; y < dstHeight; ++y ) {
+		int64_t fy = std::max<int64_t>( ( y * stepY ) + ( stepY >> 1 ) - 0x8000, 0 );
+		int y0 = std::min( (int)( fy >> 16 ), srcHeight - 1 );
+		int y1 = std::min( y0 + 1, srcHeight - 1 );
+		uint32_t wy = (uint32_t)( ( fy >> 8 ) & 0xFF );
+		const uint8_t* row0 = src + (ptrdiff_t)y0 * srcStride;
+		const uint8_t* row1 = src + (ptrdiff_t)y1 * srcStride;
+		uint8_t* dstRow = dst + (ptrdiff_t)y * dstStride;
+
+		for( int x = 0; x < dstWidth; ++x ) {
+			int64_t fx = std::max<int64_t>( ( x * stepX ) + ( stepX >> 1 ) - 0x8000, 0 );
+			int x0 = std::min( (int)( fx >> 16 ), srcWidth - 1 );
+			int x1 = std::min( x0 + 1, srcWidth - 1 );
+			uint32_t wx = (uint32_t)( ( fx >> 8 ) & 0xFF );
+			for( int c = 0; c < 4; ++c ) {
+				uint32_t top = row0[x0 * 4 + c] * ( 256 - wx ) + row0[x1 * 4 + c] * wx;
+				uint32_t bottom = row1[x0 * 4 + c] * ( 256 - wx ) + row1[x1 * 4 + c] * wx;
+				dstRow[x * 4 + c] = (uint8_t)( ( top * ( 256 - wy ) + bottom * wy + 32768 ) >> 16 );
+			}
+		}
+	}
+}
+
+inline uint8_t clamp8( int v )
+{
+	return (uint8_t)( v < 0 ? 0 : ( v > 255 ? 255 : v ) );
+}
+
+// exact round( c * a / 255 ) without a division.
+inline uint8_t mulDiv255( uint32_t c, uint32_t a )
+{
+	uint32_t v = c * a + 128;
+	return (uint8_t)( ( v + ( v >> 8 ) ) >> 8 );
+}
+
+// 16.16 reciprocals of alpha / 255 so unpremultiplying needs no per channel division.
+struct ReciprocalTable {
+	ReciprocalTable()
+	{
+		values[0] = 0;
+		for( uint32_t a = 1; a < 256; ++a ) {
+			values[a] = ( 255u * 65536u + a / 2 ) / a;
+		}
+	}
+	uint32_t values[256];
+};
+
+#if CINDER_NDI_CONVERT_SSE2
+// premultiplies the four pixels of a register, same rounding as mulDiv255.
+inline __m128i premultiply4( __m128i pixels )
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16( 128 );
+	const __m128i alphaMask = _mm_set_epi16( -1, 0, 0, 0, -1, 0, 0, 0 );
+
+	__m128i result[2];
+	for( int i = 0; i < 2; ++i ) {
+		__m128i wide = i == 0 ? _mm_unpacklo_epi8( pixels, zero ) : _mm_unpackhi_epi8( pixels, zero );
+		__m128i alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( wide, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 3, 3, 3, 3 ) );
+		__m128i v = _mm_add_epi16( _mm_mullo_epi16( wide, alpha ), bias );
+		v = _mm_srli_epi16( _mm_add_epi16( v, _mm_srli_epi16( v, 8 ) ), 8 );
+		result[i] = _mm_or_si128( _mm_andnot_si128( alphaMask, v ), _mm_and_si128( alphaMask, wide ) );
+	}
+	return _mm_packus_epi16( result[0], result[1] );
+}
+#endif
+
+} // anonymous namespace
+
+void CinderNDIConvert::scaleBGRA( const uint8_t* src, ptrdiff_t srcStride, int srcWidth, int srcHeight,
+								  uint8_t* dst, ptrdiff_t dstStride, int dstWidth, int dstHeight )
+{
+	if( dstWidth <= 0 || dstHeight <= 0 || srcWidth <= 0 || srcHeight <= 0 ) {
+		return;
+	}
+
+	if( srcWidth % dstWidth == 0 && srcHeight % dstHeight == 0 ) {
+		boxScale( src, srcStride, dst, dstStride, dstWidth, dstHeight, srcWidth / dstWidth, srcHeight / dstHeight );
+	}
+	else {
+		bilinearScale( src, srcStride, srcWidth, srcHeight, dst, dstStride, dstWidth, dstHeight );
+	}
+}
+
+void CinderNDIConvert::bgraToUYVY( const uint8_t* src, ptrdiff_t srcStride, int width, int height, uint8_t* dst, ptrdiff_t dstStride )
+{
+	for( int y = 0; y < height; ++y ) {
+		const uint8_t* s = src + (ptrdiff_t)y * srcStride;
+		uint8_t* d = dst + (ptrdiff_t)y * dstStride;
+		for( int x = 0; x + 1 < width; x += 2, s += 8, d += 4 ) {
+			const int b0 = s[0], g0 = s[1], r0 = s[2];
+			const int b1 = s[4], g1 = s[5], r1 = s[6];
+			const int r = r0 + r1, g = g0 + g1, b = b0 + b1;
+			d[0] = clamp8( 128 + ( ( -26 * r - 86 * g + 112 * b + 256 ) >> 9 ) );
+			d[1] = clamp8( 16 + ( ( 47 * r0 + 157 * g0 + 16 * b0 + 128 ) >> 8 ) );
+			d[2] = clamp8( 128 + ( ( 112 * r - 102 * g - 10 * b + 256 ) >> 9 ) );
+			d[3] = clamp8( 16 + ( ( 47 * r1 + 157 * g1 + 16 * b1 + 128 ) >> 8 ) );
+		}
+		if( width & 1 ) {
+			const int b0 = s[0], g0 = s[1], r0 = s[2];
+			d[0] = clamp8( 128 + ( ( -26 * r0 - 86 * g0 + 112 * b0 + 128 ) >> 8 ) );
+			d[1] = clamp8( 16 + ( ( 47 * r0 + 157 * g0 + 16 * b0 + 128 ) >> 8 ) );
+			d[2] = clamp8( 128 + ( ( 112 * r0 - 102 * g0 - 10 * b0 + 128 ) >> 8 ) );
+			d[3] = d[1];
+		}
+	}
+}
+
+void CinderNDIConvert::bgraToUYVA( const uint8_t* src, ptrdiff_t srcStride, int width, int height, uint8_t* dst, ptrdiff_t dstStride )
+{
+	bgraToUYVY( src, srcStride, width, height, dst, dstStride );
+	uint8_t* alpha = dst + (ptrdiff_t)height * dstStride;
+	const ptrdiff_t alphaStride = dstStride / 2;
+	extractAlpha( src, srcStride, width, height, alpha, alphaStride );
+	// an odd width leaves a byte of padding per alpha row, repeated like the last pixel of the UYVY row.
+	if( width & 1 && alphaStride > width ) {
+		for( int y = 0; y < height; ++y ) {
+			alpha[(ptrdiff_t)y * alphaStride + width] = alpha[(ptrdiff_t)y * alphaStride + width - 1];
+		}
+	}
+}
+
+void CinderNDIConvert::premultiplyBGRA( const uint8_t* src, ptrdiff_t srcStride, int width, int height, uint8_t* dst, ptrdiff_t dstStride )
+{
+	for( int y = 0; y < height; ++y ) {
+		const uint8_t* s = src + (ptrdiff_t)y * srcStride;
+		uint8_t* d = dst + (ptrdiff_t)y * dstStride;
+		int x = 0;
+#if CINDER_NDI_CONVERT_SSE2
+		for( ; x + 4 <= width; x += 4, s += 16, d += 16 ) {
+			_mm_storeu_si128( (__m128i*)d, premultiply4( _mm_loadu_si128( (const __m128i*)s ) ) );
+		}
+#endif
+		for( ; x < width; ++x, s += 4, d += 4 ) {
+			const uint32_t a = s[3];
+			d[0] = mulDiv255( s[0], a );
+			d[1] = mulDiv255( s[1], a );
+			d[2] = mulDiv255( s[2], a );
+			d[3] = (uint8_t)a;
+		}
+	}
+}
+
+void CinderNDIConvert::unpremultiplyBGRA( const uint8_t* src, ptrdiff_t srcStride, int width, int height, uint8_t* dst, ptrdiff_t dstStride )
+{
+	static const ReciprocalTable sReciprocals;
+
+	for( int y = 0; y < height; ++y ) {
+		const uint8_t* s = src + (ptrdiff_t)y * srcStride;
+		uint8_t* d = dst + (ptrdiff_t)y * dstStride;
+		for( int x = 0; x < width; ++x, s += 4, d += 4 ) {
+			const uint32_t a = s[3];
+			const uint32_t r = sReciprocals.values[a];
+			d[0] = (uint8_t)std::min<uint32_t>( 255, ( s[0] * r + 32768 ) >> 16 );
+			d[1] = (uint8_t)std::min<uint32_t>( 255, ( s[1] * r + 32768 ) >> 16 );
+			d[2] = (uint8_t)std::min<uint32_t>( 255, ( s[2] * r + 32768 ) >> 16 );
+			d[3] = (uint8_t)a;
+		}
+	}
+}
+
+void CinderNDIConvert::extractAlpha( const uint8_t* src, ptrdiff_t srcStride, int width, int height, uint8_t* dst, ptrdiff_t dstStride )
+{
+	for( int y = 0; y < height; ++y ) {
+		const uint8_t* s = src + (ptrdiff_t)y * srcStride;
+		uint8_t* d = dst + (ptrdiff_t)y * dstStride;
+		int x = 0;
+#if CINDER_NDI_CONVERT_SSE2
+		// shift alpha into the low byte of each pixel and pack 16 pixels down to 16 bytes.
+		for( ; x + 16 <= width; x += 16, s += 64, d += 16 ) {
+			__m128i p0 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i*)s ), 24 );
+			__m128i p1 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i*)s + 1 ), 24 );
+			__m128i p2 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i*)s + 2 ), 24 );
+			__m128i p3 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i*)s + 3 ), 24 );
+			_mm_storeu_si128( (__m128i*)d, _mm_packus_epi16( _mm_packs_epi32( p0, p1 ), _mm_packs_epi32( p2, p3 ) ) );
+		}
+#endif
+		for( ; x < width; ++x, s += 4 ) {
+			*d++ = s[3];
+		}
+	}
+}
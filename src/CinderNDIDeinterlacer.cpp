@@ -0,0 +1,165 @@
+#include "CinderNDIDeinterlacer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "cinder/Log.h"
+
+namespace {
+
+const char* kVertexShader = R"(
+#version 150
+uniform mat4 ciModelViewProjection;
+in vec4 ciPosition;
+void main() {
+	gl_Position = ciModelViewProjection * ciPosition;
+}
+)";
+
+// Works in whole texels so the output rows line up with the uploaded lines whatever the
+// orientation of the textures. uCurrent holds the lines of parity uParity, uOpposite the most
+// recent field of the other parity and uPrevious the field before uCurrent.
+const char* kFragmentShader = R"(
+#version 150
+uniform sampler2D uCurrent;
+uniform sampler2D uOpposite;
+uniform sampler2D uPrevious;
+uniform int uParity;
+uniform int uMode;
+uniform float uThreshold;
+out vec4 oColor;
+
+vec4 fetch( sampler2D field, int x, int line ) {
+	int lines = textureSize( field, 0 ).y;
+	return texelFetch( field, ivec2( x, clamp( line, 0, lines - 1 ) ), 0 );
+}
+
+void main() {
+	int x = int( gl_FragCoord.x );
+	int y = int( gl_FragCoord.y );
+	int line = y / 2;
+	if( ( y & 1 ) == uParity ) {
+		oColor = fetch( uCurrent, x, line );
+		return;
+	}
+
+	// the lines of the current field directly above and below the missing one.
+	int above = uParity == 0 ? line : line - 1;
+	vec4 a = fetch( uCurrent, x, above );
+	vec4 b = fetch( uCurrent, x, above + 1 );
+	vec4 interpolated = 0.5 * ( a + b );
+	vec4 woven = fetch( uOpposite, x, line );
+
+	if( uMode == 0 ) {
+		oColor = woven;
+	}
+	else if( uMode == 1 ) {
+		oColor = interpolated;
+	}
+	else {
+		float motion = max( distance( a.rgb, fetch( uPrevious, x, above ).rgb ), distance( b.rgb, fetch( uPrevious, x, above + 1 ).rgb ) );
+		oColor = mix( woven, interpolated, smoothstep( uThreshold, 2.0 * uThreshold, motion ) );
+	}
+}
+)";
+
+} // anonymous namespace
+
+CinderNDIDeinterlacer::CinderNDIDeinterlacer()
+	: mMode{ Mode::Weave }, mMotionThreshold{ 0.06f }
+{
+	mNumFields[0] = mNumFields[1] = 0;
+}
+
+void CinderNDIDeinterlacer::reset()
+{
+	mNumFields[0] = mNumFields[1] = 0;
+}
+
+void CinderNDIDeinterlacer::addField( const uint8_t* data, int stride, int width, int lines, int field )
+{
+	uploadField( data, stride / 4, width, lines, field & 1 );
+}
+
+void CinderNDIDeinterlacer::addInterleavedFrame( const uint8_t* data, int stride, int width, int height )
+{
+	// a row length of two lines makes GL skip the other field while unpacking.
+	uploadField( data, stride / 2, width, ( height + 1 ) / 2, 0 );
+	uploadField( data + stride, stride / 2, width, height / 2, 1 );
+}
+
+void CinderNDIDeinterlacer::uploadField( const uint8_t* data, int rowLength, int width, int lines, int field )
+{
+	if( lines <= 0 || width <= 0 ) {
+		return;
+	}
+
+	// the oldest texture of this parity becomes the newest.
+	std::swap( mFields[field][0], mFields[field][1] );
+	auto& texture = mFields[field][0];
+	if( ! texture || texture->getWidth() != width || texture->getHeight() != lines ) {
+		auto format = ci::gl::Texture2d::Format().internalFormat( GL_RGBA8 ).minFilter( GL_NEAREST ).magFilter( GL_NEAREST );
+		texture = ci::gl::Texture2d::create( width, lines, format );
+		mNumFields[field] = 0;
+	}
+
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, rowLength );
+	texture->update( data, GL_BGRA, GL_UNSIGNED_BYTE, 0, width, lines );
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+	mNumFields[field] = std::min( mNumFields[field] + 1, 2 );
+}
+
+ci::gl::Texture2dRef CinderNDIDeinterlacer::render( int field )
+{
+	field &= 1;
+	if( mNumFields[field] == 0 ) {
+		return ci::gl::Texture2dRef();
+	}
+
+	if( ! mProg ) {
+		try {
+			mProg = ci::gl::GlslProg::create( ci::gl::GlslProg::Format().vertex( kVertexShader ).fragment( kFragmentShader ) );
+		}
+		catch( const std::exception& e ) {
+			CI_LOG_E( "Failed to create NDI deinterlace shader: " << e.what() );
+			return ci::gl::Texture2dRef();
+		}
+	}
+
+	const auto& current = mFields[field][0];
+	const ci::ivec2 size( current->getWidth(), current->getHeight() * 2 );
+	if( ! mFbo || mFbo->getSize() != size ) {
+		auto textureFormat = ci::gl::Texture2d::Format().minFilter( GL_LINEAR ).magFilter( GL_LINEAR );
+		mFbo = ci::gl::Fbo::create( size.x, size.y, ci::gl::Fbo::Format().colorTexture( textureFormat ).disableDepth() );
+	}
+
+	// until a field of each kind has arrived the missing lines can only be interpolated.
+	const auto& other = mFields[1 - field][0];
+	const bool canWeave = other && mNumFields[1 - field] > 0 && other->getWidth() == current->getWidth() && other->getHeight() == current->getHeight();
+	const bool hasPrevious = mNumFields[field] > 1;
+	int mode = 1;
+	if( canWeave && mMode == Mode::Weave ) {
+		mode = 0;
+	}
+	else if( canWeave && mMode == Mode::MotionAdaptive ) {
+		mode = hasPrevious ? 2 : 0;
+	}
+
+	ci::gl::ScopedFramebuffer scopedFbo( mFbo );
+	ci::gl::ScopedViewport scopedViewport( ci::ivec2( 0 ), size );
+	ci::gl::ScopedMatrices scopedMatrices;
+	ci::gl::setMatricesWindow( size );
+	ci::gl::ScopedGlslProg scopedProg( mProg );
+	ci::gl::ScopedTextureBind scopedCurrent( current, 0 );
+	ci::gl::ScopedTextureBind scopedOpposite( canWeave ? other : current, 1 );
+	ci::gl::ScopedTextureBind scopedPrevious( hasPrevious ? mFields[field][1] : current, 2 );
+	mProg->uniform( "uCurrent", 0 );
+	mProg->uniform( "uOpposite", 1 );
+	mProg->uniform( "uPrevious", 2 );
+	mProg->uniform( "uParity", field );
+	mProg->uniform( "uMode", mode );
+	mProg->uniform( "uThreshold", mMotionThreshold );
+	ci::gl::drawSolidRect( ci::Rectf( 0, 0, (float)size.x, (float)size.y ) );
+
+	return mFbo->getColorTexture();
+}
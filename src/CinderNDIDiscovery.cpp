@@ -0,0 +1,170 @@
+#include "CinderNDIDiscovery.h"
+
+#include <map>
+#include <algorithm>
+
+#include "cinder/Log.h"
+
+#include "CinderNDISourceMatcher.h"
+
+#include <Processing.NDI.Find.h>
+
+namespace {
+
+// Only bounds how long destruction waits, NDI returns as soon as the list changes.
+const uint32_t kWaitTimeoutMs = 500;
+// How often the list is checked when no blocking thread was left for the discovery.
+const std::chrono::milliseconds kPollInterval( 100 );
+
+} // anonymous namespace
+
+CinderNDIDiscovery::CinderNDIDiscovery( bool showLocalSources, const std::string& groups, const std::string& extraIps )
+	: mNdiFinder{ nullptr }, mGroups{ groups }, mExtraIps{ extraIps }, mMatcher{ std::make_shared<CinderNDISourceMatcher>() },
+	mNumChanges{ 0 }, mNextListenerId{ 1 }, mHasSources{ false }
+{
+	if( ! NDIlib_initialize() ) {
+		CI_LOG_E( "Failed to initialize NDI!" );
+	}
+
+	NDIlib_find_create_t NDI_find_create_desc;
+	NDI_find_create_desc.show_local_sources = showLocalSources;
+	NDI_find_create_desc.p_groups = mGroups.empty() ? NULL : mGroups.c_str();
+	NDI_find_create_desc.p_extra_ips = mExtraIps.empty() ? NULL : mExtraIps.c_str();
+	mNdiFinder = NDIlib_find_create_v2( &NDI_find_create_desc );
+	if( ! mNdiFinder ) {
+		CI_LOG_E( "Failed to create NDI finder!" );
+		return;
+	}
+
+	mThreadPool = CinderNDIThreadPool::getDefault();
+	mJob = mThreadPool->startBlockingJob( "NDI discovery", [this]( bool mayBlock ) { return discover( mayBlock ); } );
+}
+
+CinderNDIDiscovery::~CinderNDIDiscovery()
+{
+	if( mJob ) {
+		mThreadPool->stopJob( mJob );
+	}
+	if( mNdiFinder ) {
+		NDIlib_find_destroy( mNdiFinder );
+	}
+	NDIlib_destroy();
+}
+
+std::shared_ptr<CinderNDIDiscovery> CinderNDIDiscovery::getDefault()
+{
+	static std::mutex sMutex;
+	static std::weak_ptr<CinderNDIDiscovery> sDefault;
+
+	std::lock_guard<std::mutex> lock( sMutex );
+	auto discovery = sDefault.lock();
+	if( ! discovery ) {
+		discovery = std::make_shared<CinderNDIDiscovery>();
+		sDefault = discovery;
+	}
+	return discovery;
+}
+
+std::vector<CinderNDIDiscovery::Source> CinderNDIDiscovery::getSources() const
+{
+	std::lock_guard<std::mutex> lock( mSourcesMutex );
+	return mSources;
+}
+
+std::shared_ptr<const CinderNDISourceMatcher> CinderNDIDiscovery::getMatcher() const
+{
+	std::lock_guard<std::mutex> lock( mSourcesMutex );
+	return mMatcher;
+}
+
+size_t CinderNDIDiscovery::addListener( const Listener& listener, bool replay )
+{
+	// holding the listener lock keeps the discovery thread from reporting a change in between.
+	std::lock_guard<std::recursive_mutex> lock( mListenersMutex );
+	const size_t id = mNextListenerId++;
+	mListeners.push_back( std::make_pair( id, listener ) );
+	if( replay ) {
+		for( const auto& source : getSources() ) {
+			listener( Event::Added, source );
+		}
+	}
+	return id;
+}
+
+void CinderNDIDiscovery::removeListener( size_t id )
+{
+	std::lock_guard<std::recursive_mutex> lock( mListenersMutex );
+	mListeners.erase( std::remove_if( mListeners.begin(), mListeners.end(), [id]( const std::pair<size_t, Listener>& listener ) {
+		return listener.first == id;
+	} ), mListeners.end() );
+}
+
+CinderNDIThreadPool::Clock::time_point CinderNDIDiscovery::discover( bool mayBlock )
+{
+	// on a blocking thread NDI wakes the job when the list changes, otherwise a zero timeout only asks
+	// whether it changed since the last call and the wait is the pool's.
+	if( NDIlib_find_wait_for_sources( mNdiFinder, mayBlock && mHasSources ? kWaitTimeoutMs : 0 ) || ! mHasSources ) {
+		mHasSources = true;
+		updateSources();
+	}
+	return mayBlock ? CinderNDIThreadPool::Clock::now() : CinderNDIThreadPool::Clock::now() + kPollInterval;
+}
+
+void CinderNDIDiscovery::updateSources()
+{
+	// the strings NDI returns only live until the next call, so they are copied right away.
+	uint32_t numSources = 0;
+	const NDIlib_source_t* ndiSources = NDIlib_find_get_current_sources( mNdiFinder, &numSources );
+	std::vector<Source> sources( numSources );
+	for( uint32_t i = 0; i < numSources; ++i ) {
+		sources[i].name = ndiSources[i].p_ndi_name ? ndiSources[i].p_ndi_name : "";
+		sources[i].url = ndiSources[i].p_url_address ? ndiSources[i].p_url_address : "";
+	}
+
+	// indexed up front, most updates change something and the lock is then only held for the swap.
+	auto matcher = std::make_shared<CinderNDISourceMatcher>();
+	matcher->update( sources );
+
+	std::lock_guard<std::recursive_mutex> listenersLock( mListenersMutex );
+	std::vector<std::pair<Event, Source>> events;
+	{
+		std::lock_guard<std::mutex> lock( mSourcesMutex );
+		std::map<std::string, const Source*> previous;
+		for( const auto& source : mSources ) {
+			previous[source.name] = &source;
+		}
+		for( const auto& source : sources ) {
+			auto it = previous.find( source.name );
+			if( it == previous.end() ) {
+				events.push_back( std::make_pair( Event::Added, source ) );
+			}
+			else {
+				if( it->second->url != source.url ) {
+					events.push_back( std::make_pair( Event::Changed, source ) );
+				}
+				previous.erase( it );
+			}
+		}
+		for( const auto& removed : previous ) {
+			events.push_back( std::make_pair( Event::Removed, *removed.second ) );
+		}
+		if( events.empty() ) {
+			return;
+		}
+		mSources.swap( sources );
+		mMatcher = matcher;
+		++mNumChanges;
+	}
+
+	// a copy, so listeners can remove themselves while they run. Removed ones get no further events.
+	auto listeners = mListeners;
+	for( const auto& event : events ) {
+		CI_LOG_I( "NDI source " << ( event.first == Event::Added ? "added" : ( event.first == Event::Removed ? "removed" : "changed" ) ) << ": '" << event.second.name << "'" );
+		for( const auto& listener : listeners ) {
+			const size_t id = listener.first;
+			if( std::any_of( mListeners.begin(), mListeners.end(), [id]( const std::pair<size_t, Listener>& registered ) { return registered.first == id; } ) ) {
+				listener.second( event.first, event.second );
+			}
+		}
+	}
+}
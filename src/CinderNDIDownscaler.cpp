@@ -0,0 +1,170 @@
+#include "CinderNDIDownscaler.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "cinder/Log.h"
+
+namespace {
+
+const char* kVertexShader = R"(
+#version 150
+uniform mat4 ciModelViewProjection;
+in vec4 ciPosition;
+in vec2 ciTexCoord0;
+out vec2 vTexCoord;
+void main() {
+	vTexCoord = ciTexCoord0;
+	gl_Position = ciModelViewProjection * ciPosition;
+}
+)";
+
+// Spreads uTaps linear taps evenly over the source footprint of the output pixel. Every tap
+// already averages 2x2 texels, so up to 8 taps per axis cover factors of 16 exactly.
+const char* kBoxFragmentShader = R"(
+#version 150
+uniform sampler2D uTex;
+uniform vec2 uTexelSize;
+uniform vec2 uFootprint;
+uniform ivec2 uTaps;
+in vec2 vTexCoord;
+out vec4 oColor;
+void main() {
+	vec2 stepSize = uFootprint / vec2( uTaps ) * uTexelSize;
+	vec2 origin = vTexCoord - 0.5 * uFootprint * uTexelSize + 0.5 * stepSize;
+	vec4 sum = vec4( 0.0 );
+	for( int y = 0; y < uTaps.y; ++y ) {
+		for( int x = 0; x < uTaps.x; ++x ) {
+			sum += texture( uTex, origin + vec2( x, y ) * stepSize );
+		}
+	}
+	oColor = sum / float( uTaps.x * uTaps.y );
+}
+)";
+
+const char* kSampleFragmentShader = R"(
+#version 150
+uniform sampler2D uTex;
+in vec2 vTexCoord;
+out vec4 oColor;
+void main() {
+	oColor = texture( uTex, vTexCoord );
+}
+)";
+
+} // anonymous namespace
+
+CinderNDIDownscaler::CinderNDIDownscaler()
+{
+}
+
+size_t CinderNDIDownscaler::addVariant( const std::string& name, const ci::ivec2& size, Filter filter )
+{
+	Variant variant;
+	variant.size = size;
+	variant.filter = filter;
+	variant.sender.reset( new CinderNDISender( name ) );
+	mVariants.push_back( std::move( variant ) );
+	return mVariants.size() - 1;
+}
+
+void CinderNDIDownscaler::setFramerate( int numerator, int denominator )
+{
+	for( auto& variant : mVariants ) {
+		variant.sender->setFramerate( numerator, denominator );
+	}
+}
+
+ci::gl::Texture2dRef CinderNDIDownscaler::updateMipChain( const ci::gl::Texture2dRef& source )
+{
+	if( ! mMipFbo || mMipFbo->getSize() != source->getSize() ) {
+		auto textureFormat = ci::gl::Texture2d::Format().mipmap().minFilter( GL_LINEAR_MIPMAP_LINEAR ).magFilter( GL_LINEAR );
+		mMipFbo = ci::gl::Fbo::create( source->getWidth(), source->getHeight(), ci::gl::Fbo::Format().colorTexture( textureFormat ).disableDepth() );
+	}
+
+	{
+		ci::gl::ScopedFramebuffer scopedFbo( mMipFbo );
+		ci::gl::ScopedViewport scopedViewport( ci::ivec2( 0 ), mMipFbo->getSize() );
+		ci::gl::ScopedMatrices scopedMatrices;
+		ci::gl::setMatricesWindow( mMipFbo->getSize() );
+		ci::gl::ScopedGlslProg scopedProg( mSampleProg );
+		ci::gl::ScopedTextureBind scopedTex( source, 0 );
+		mSampleProg->uniform( "uTex", 0 );
+		ci::gl::drawSolidRect( ci::Rectf( 0, 0, (float)source->getWidth(), (float)source->getHeight() ) );
+	}
+
+	auto texture = mMipFbo->getColorTexture();
+	ci::gl::ScopedTextureBind scopedTex( texture, 0 );
+	glGenerateMipmap( GL_TEXTURE_2D );
+	return texture;
+}
+
+void CinderNDIDownscaler::render( Variant& variant, const ci::gl::Texture2dRef& source, const ci::gl::Texture2dRef& mipChain )
+{
+	if( ! variant.fbo ) {
+		variant.fbo = ci::gl::Fbo::create( variant.size.x, variant.size.y, ci::gl::Fbo::Format().disableDepth() );
+		variant.readback.reset( new CinderNDIReadback( variant.size.x, variant.size.y ) );
+	}
+
+	const ci::gl::Texture2dRef& input = variant.filter == Filter::Mipmap ? mipChain : source;
+
+	ci::gl::ScopedFramebuffer scopedFbo( variant.fbo );
+	ci::gl::ScopedViewport scopedViewport( ci::ivec2( 0 ), variant.size );
+	ci::gl::ScopedMatrices scopedMatrices;
+	ci::gl::setMatricesWindow( variant.size );
+	ci::gl::ScopedTextureBind scopedTex( input, 0 );
+
+	if( variant.filter == Filter::Box ) {
+		const float footprintX = (float)source->getWidth() / variant.size.x;
+		const float footprintY = (float)source->getHeight() / variant.size.y;
+		// each linear tap averages two texels per axis.
+		const ci::ivec2 taps( std::max( 1, std::min( 8, (int)std::ceil( footprintX * 0.5f ) ) ), std::max( 1, std::min( 8, (int)std::ceil( footprintY * 0.5f ) ) ) );
+
+		ci::gl::ScopedGlslProg scopedProg( mBoxProg );
+		mBoxProg->uniform( "uTex", 0 );
+		mBoxProg->uniform( "uTexelSize", ci::vec2( 1.0f / source->getWidth(), 1.0f / source->getHeight() ) );
+		mBoxProg->uniform( "uFootprint", ci::vec2( footprintX, footprintY ) );
+		mBoxProg->uniform( "uTaps", taps );
+		ci::gl::drawSolidRect( ci::Rectf( 0, 0, (float)variant.size.x, (float)variant.size.y ) );
+	}
+	else {
+		ci::gl::ScopedGlslProg scopedProg( mSampleProg );
+		mSampleProg->uniform( "uTex", 0 );
+		ci::gl::drawSolidRect( ci::Rectf( 0, 0, (float)variant.size.x, (float)variant.size.y ) );
+	}
+}
+
+void CinderNDIDownscaler::send( const ci::gl::Texture2dRef& source, long long timecode )
+{
+	if( ! source ) {
+		return;
+	}
+
+	if( ! mBoxProg ) {
+		try {
+			mBoxProg = ci::gl::GlslProg::create( ci::gl::GlslProg::Format().vertex( kVertexShader ).fragment( kBoxFragmentShader ) );
+			mSampleProg = ci::gl::GlslProg::create( ci::gl::GlslProg::Format().vertex( kVertexShader ).fragment( kSampleFragmentShader ) );
+		}
+		catch( const std::exception& e ) {
+			CI_LOG_E( "Failed to create NDI downscale shaders: " << e.what() );
+			return;
+		}
+	}
+
+	// the mip chain is shared by all mipmapped variants and only built when one of them is watched.
+	ci::gl::Texture2dRef mipChain;
+	for( auto& variant : mVariants ) {
+		if( ! variant.sender->shouldSendFrame() ) {
+			continue;
+		}
+
+		if( variant.filter == Filter::Mipmap && ! mipChain ) {
+			mipChain = updateMipChain( source );
+		}
+		render( variant, source, mipChain );
+		variant.readback->markAllDirty();
+		variant.readback->readback( variant.fbo );
+		auto surface = variant.readback->getSurface();
+		variant.sender->sendSurface( *surface, surface->getBounds(), timecode, true );
+	}
+}
@@ -0,0 +1,97 @@
+#include "CinderNDIFrameClock.h"
+
+#include <thread>
+#include <algorithm>
+
+CinderNDIFrameClock::CinderNDIFrameClock( int numerator, int denominator )
+	: mNumerator{ numerator }, mDenominator{ denominator }, mTick{ 0 }, mSleepOvershoot{ std::chrono::milliseconds( 1 ) }, mWakeTime{},
+	mMaxSpin{ std::chrono::milliseconds( 4 ) }
+{
+	reset();
+}
+
+void CinderNDIFrameClock::setRate( int numerator, int denominator )
+{
+	if( numerator <= 0 || denominator <= 0 ) {
+		return;
+	}
+	mNumerator = numerator;
+	mDenominator = denominator;
+	reset();
+}
+
+void CinderNDIFrameClock::reset()
+{
+	mStart = Clock::now();
+	mTick = 0;
+	mWakeTime = Clock::time_point();
+}
+
+CinderNDIFrameClock::Clock::time_point CinderNDIFrameClock::getDeadline( uint64_t tick ) const
+{
+	// tick * D / N seconds, split into whole seconds and remainder so the nanosecond product can't overflow.
+	const uint64_t scaled = tick * (uint64_t)mDenominator;
+	const uint64_t seconds = scaled / mNumerator;
+	const uint64_t remainder = scaled % mNumerator;
+	const uint64_t nanos = seconds * 1000000000ULL + remainder * 1000000000ULL / mNumerator;
+	return mStart + std::chrono::duration_cast<Clock::duration>( std::chrono::nanoseconds( nanos ) );
+}
+
+CinderNDIFrameClock::Clock::time_point CinderNDIFrameClock::getNextWakeTime()
+{
+	// twice the typical lateness ahead, like the spin margin, but never more than half a period.
+	const auto deadline = getDeadline( mTick + 1 );
+	const auto period = deadline - getDeadline( mTick );
+	const auto ahead = std::min<Clock::duration>( std::chrono::duration_cast<Clock::duration>( mSleepOvershoot * 2 ), period / 2 );
+	mWakeTime = deadline - ahead;
+	return mWakeTime;
+}
+
+uint64_t CinderNDIFrameClock::waitForNextTick()
+{
+	uint64_t skipped = 0;
+	auto now = Clock::now();
+
+	if( mWakeTime != Clock::time_point() ) {
+		trackOvershoot( now - mWakeTime );
+		mWakeTime = Clock::time_point();
+	}
+	auto deadline = getDeadline( mTick + 1 );
+
+	// more than a whole period late: jump to the tick that covers now.
+	if( now > getDeadline( mTick + 2 ) ) {
+		const uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( now - mStart ).count();
+		const uint64_t current = (uint64_t)( (double)elapsed * mNumerator / ( mDenominator * 1e9 ) );
+		skipped = current - mTick;
+		mTick = current;
+		deadline = getDeadline( mTick + 1 );
+	}
+
+	waitUntil( deadline );
+	++mTick;
+	return skipped;
+}
+
+void CinderNDIFrameClock::waitUntil( Clock::time_point deadline )
+{
+	auto spin = std::min<std::chrono::nanoseconds>( mSleepOvershoot * 2, mMaxSpin );
+	auto wake = deadline - spin;
+	auto now = Clock::now();
+
+	if( now < wake ) {
+		std::this_thread::sleep_until( wake );
+		trackOvershoot( Clock::now() - wake );
+	}
+
+	while( Clock::now() < deadline ) {
+		std::this_thread::yield();
+	}
+}
+
+void CinderNDIFrameClock::trackOvershoot( Clock::duration overshoot )
+{
+	// how late the OS wakes us up (moving average), so the spin margin follows the timer resolution.
+	if( overshoot.count() > 0 ) {
+		mSleepOvershoot = ( mSleepOvershoot * 7 + std::chrono::duration_cast<std::chrono::nanoseconds>( overshoot ) ) / 8;
+	}
+}
@@ -0,0 +1,311 @@
+#include "CinderNDIFrameFile.h"
+
+#include <cstring>
+#include <algorithm>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "cinder/Log.h"
+
+#include "CinderNDISender.h"
+
+namespace {
+
+const size_t kChunkSize = 4 * 1024 * 1024;
+
+// the frame's rows, and the alpha plane of UYVA behind them, fit into the bytes the entry claims.
+bool isValidFrame( const CinderNDIFrameFile::IndexEntry& entry )
+{
+	if( entry.xres <= 0 || entry.yres <= 0 ) {
+		return false;
+	}
+	const NDIlib_FourCC_type_e fourCC = (NDIlib_FourCC_type_e)entry.fourCC;
+	const int rowBytes = CinderNDISender::calcLineStride( entry.xres, fourCC );
+	if( ! rowBytes || entry.lineStride < rowBytes ) {
+		return false;
+	}
+	uint64_t frameBytes = (uint64_t)entry.lineStride * (uint64_t)entry.yres;
+	if( fourCC == NDIlib_FourCC_type_UYVA ) {
+		frameBytes += (uint64_t)( entry.lineStride / 2 ) * (uint64_t)entry.yres;
+	}
+	return frameBytes <= entry.size;
+}
+
+} // anonymous namespace
+
+CinderNDIFrameFileWriter::CinderNDIFrameFileWriter()
+	: mFile{ nullptr }, mChunk{ nullptr }, mChunkFill{ 0 }, mFileOffset{ 0 }, mNumBytesWritten{ 0 }, mFailed{ false }
+{
+}
+
+CinderNDIFrameFileWriter::~CinderNDIFrameFileWriter()
+{
+	close();
+}
+
+bool CinderNDIFrameFileWriter::open( const std::string& path )
+{
+	close();
+
+	mFile = std::fopen( path.c_str(), "wb" );
+	if( ! mFile ) {
+		CI_LOG_E( "Failed to open NDI frame file '" << path << "'" );
+		return false;
+	}
+	// we only ever write whole chunks, stdio buffering would just add a copy.
+	std::setvbuf( mFile, nullptr, _IONBF, 0 );
+
+	if( ! mChunkStorage ) {
+		const size_t alignment = CinderNDIFrameFile::kAlignment;
+		mChunkStorage.reset( new uint8_t[kChunkSize + alignment] );
+		mChunk = mChunkStorage.get() + ( alignment - ( (uintptr_t)mChunkStorage.get() % alignment ) ) % alignment;
+	}
+	mPath = path;
+	mChunkFill = 0;
+	mFileOffset = 0;
+	mNumBytesWritten = 0;
+	mFailed = false;
+	mIndex.clear();
+
+	// reserve room for the header, it is only filled in by close().
+	CinderNDIFrameFile::Header header = {};
+	append( &header, sizeof( header ) );
+	return true;
+}
+
+void CinderNDIFrameFileWriter::close()
+{
+	if( ! mFile ) {
+		return;
+	}
+
+	pad();
+	CinderNDIFrameFile::Header header;
+	std::memcpy( header.magic, "CNDF", 4 );
+	header.version = CinderNDIFrameFile::kVersion;
+	header.numFrames = mIndex.size();
+	header.indexOffset = mFileOffset;
+	header.alignment = CinderNDIFrameFile::kAlignment;
+	header.reserved = 0;
+	if( ! mIndex.empty() ) {
+		append( mIndex.data(), mIndex.size() * sizeof( CinderNDIFrameFile::IndexEntry ) );
+	}
+	if( mChunkFill ) {
+		writeChunk( mChunkFill );
+	}
+
+	if( std::fseek( mFile, 0, SEEK_SET ) != 0 || std::fwrite( &header, sizeof( header ), 1, mFile ) != 1 ) {
+		CI_LOG_E( "Failed to complete NDI frame file '" << mPath << "'" );
+	}
+	std::fclose( mFile );
+	mFile = nullptr;
+}
+
+bool CinderNDIFrameFileWriter::addFrame( const CinderNDIFrameFile::IndexEntry& entry, const uint8_t* data, const char* metadata )
+{
+	if( ! mFile || mFailed ) {
+		return false;
+	}
+
+	// aligned frames let readers hand the mapping to SIMD code and GPU uploads directly.
+	pad();
+	CinderNDIFrameFile::IndexEntry indexed = entry;
+	indexed.offset = mFileOffset;
+	append( data, (size_t)entry.size );
+
+	indexed.metadataOffset = 0;
+	indexed.metadataSize = 0;
+	if( metadata && *metadata ) {
+		indexed.metadataOffset = mFileOffset;
+		indexed.metadataSize = (uint32_t)std::strlen( metadata );
+		append( metadata, indexed.metadataSize + 1 );
+	}
+	indexed.reserved = 0;
+	mIndex.push_back( indexed );
+	return ! mFailed;
+}
+
+void CinderNDIFrameFileWriter::pad()
+{
+	static const uint8_t zeros[64] = {};
+	size_t padding = (size_t)( ( CinderNDIFrameFile::kAlignment - mFileOffset % CinderNDIFrameFile::kAlignment ) % CinderNDIFrameFile::kAlignment );
+	while( padding ) {
+		size_t count = std::min( padding, sizeof( zeros ) );
+		append( zeros, count );
+		padding -= count;
+	}
+}
+
+void CinderNDIFrameFileWriter::append( const void* data, size_t size )
+{
+	const uint8_t* src = static_cast<const uint8_t*>( data );
+	mFileOffset += size;
+	while( size ) {
+		size_t count = std::min( size, kChunkSize - mChunkFill );
+		std::memcpy( mChunk + mChunkFill, src, count );
+		mChunkFill += count;
+		src += count;
+		size -= count;
+		if( mChunkFill == kChunkSize ) {
+			writeChunk( kChunkSize );
+		}
+	}
+}
+
+bool CinderNDIFrameFileWriter::writeChunk( size_t size )
+{
+	mChunkFill = 0;
+	if( std::fwrite( mChunk, 1, size, mFile ) != size ) {
+		if( ! mFailed ) {
+			CI_LOG_E( "Failed to write NDI frame file '" << mPath << "'" );
+		}
+		mFailed = true;
+		return false;
+	}
+	mNumBytesWritten += size;
+	return true;
+}
+
+CinderNDIFrameFileReader::CinderNDIFrameFileReader()
+	: mData{ nullptr }, mSize{ 0 }, mEntries{ nullptr }, mNumFrames{ 0 }
+#if defined( _WIN32 )
+	, mFileHandle{ nullptr }, mMappingHandle{ nullptr }
+#else
+	, mFileDescriptor{ -1 }
+#endif
+{
+}
+
+CinderNDIFrameFileReader::~CinderNDIFrameFileReader()
+{
+	close();
+}
+
+bool CinderNDIFrameFileReader::open( const std::string& path )
+{
+	close();
+
+#if defined( _WIN32 )
+	HANDLE file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	LARGE_INTEGER fileSize;
+	if( file == INVALID_HANDLE_VALUE || ! GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart == 0 ) {
+		if( file != INVALID_HANDLE_VALUE ) {
+			CloseHandle( file );
+		}
+		CI_LOG_E( "Failed to open NDI frame file '" << path << "'" );
+		return false;
+	}
+	mFileHandle = file;
+	mSize = (uint64_t)fileSize.QuadPart;
+	mMappingHandle = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if( mMappingHandle ) {
+		mData = static_cast<const uint8_t*>( MapViewOfFile( mMappingHandle, FILE_MAP_READ, 0, 0, 0 ) );
+	}
+#else
+	mFileDescriptor = ::open( path.c_str(), O_RDONLY );
+	struct stat fileStat;
+	if( mFileDescriptor < 0 || fstat( mFileDescriptor, &fileStat ) != 0 || fileStat.st_size == 0 ) {
+		CI_LOG_E( "Failed to open NDI frame file '" << path << "'" );
+		close();
+		return false;
+	}
+	mSize = (uint64_t)fileStat.st_size;
+	void* mapping = mmap( nullptr, (size_t)mSize, PROT_READ, MAP_SHARED, mFileDescriptor, 0 );
+	if( mapping != MAP_FAILED ) {
+		mData = static_cast<const uint8_t*>( mapping );
+		madvise( mapping, (size_t)mSize, MADV_SEQUENTIAL );
+	}
+#endif
+	if( ! mData ) {
+		CI_LOG_E( "Failed to map NDI frame file '" << path << "'" );
+		close();
+		return false;
+	}
+
+	// validate everything up front so frame access needs no checks.
+	const CinderNDIFrameFile::Header* header = reinterpret_cast<const CinderNDIFrameFile::Header*>( mData );
+	if( mSize < sizeof( CinderNDIFrameFile::Header ) || std::memcmp( header->magic, "CNDF", 4 ) != 0 || header->version != CinderNDIFrameFile::kVersion
+		|| header->indexOffset > mSize || header->numFrames > ( mSize - header->indexOffset ) / sizeof( CinderNDIFrameFile::IndexEntry ) ) {
+		CI_LOG_E( "'" << path << "' is not a complete NDI frame file" );
+		close();
+		return false;
+	}
+	mEntries = reinterpret_cast<const CinderNDIFrameFile::IndexEntry*>( mData + header->indexOffset );
+	mNumFrames = (size_t)header->numFrames;
+	for( size_t i = 0; i < mNumFrames; ++i ) {
+		const auto& entry = mEntries[i];
+		if( entry.offset > mSize || entry.size > mSize - entry.offset || ( entry.metadataSize && ( entry.metadataOffset > mSize || entry.metadataSize >= mSize - entry.metadataOffset
+			|| mData[entry.metadataOffset + entry.metadataSize] != 0 ) ) ) {
+			CI_LOG_E( "NDI frame file '" << path << "' has a damaged index at frame " << i );
+			close();
+			return false;
+		}
+		if( ! isValidFrame( entry ) ) {
+			CI_LOG_E( "NDI frame file '" << path << "' has an invalid " << entry.xres << "x" << entry.yres << " frame with FourCC " << entry.fourCC
+				<< " and stride " << entry.lineStride << " at frame " << i );
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void CinderNDIFrameFileReader::close()
+{
+#if defined( _WIN32 )
+	if( mData ) {
+		UnmapViewOfFile( mData );
+	}
+	if( mMappingHandle ) {
+		CloseHandle( mMappingHandle );
+	}
+	if( mFileHandle ) {
+		CloseHandle( mFileHandle );
+	}
+	mFileHandle = nullptr;
+	mMappingHandle = nullptr;
+#else
+	if( mData ) {
+		munmap( const_cast<uint8_t*>( mData ), (size_t)mSize );
+	}
+	if( mFileDescriptor >= 0 ) {
+		::close( mFileDescriptor );
+	}
+	mFileDescriptor = -1;
+#endif
+	mData = nullptr;
+	mSize = 0;
+	mEntries = nullptr;
+	mNumFrames = 0;
+}
+
+const char* CinderNDIFrameFileReader::getMetadata( size_t index ) const
+{
+	const auto& entry = mEntries[index];
+	return entry.metadataSize ? reinterpret_cast<const char*>( mData + entry.metadataOffset ) : nullptr;
+}
+
+NDIlib_video_frame_v2_t CinderNDIFrameFileReader::getVideoFrame( size_t index ) const
+{
+	const auto& entry = mEntries[index];
+	NDIlib_video_frame_v2_t videoFrame;
+	videoFrame.xres = entry.xres;
+	videoFrame.yres = entry.yres;
+	videoFrame.FourCC = (NDIlib_FourCC_type_e)entry.fourCC;
+	videoFrame.frame_rate_N = entry.frameRateN;
+	videoFrame.frame_rate_D = entry.frameRateD;
+	videoFrame.picture_aspect_ratio = entry.pictureAspectRatio;
+	videoFrame.frame_format_type = (NDIlib_frame_format_type_e)entry.frameFormatType;
+	videoFrame.timecode = entry.timecode;
+	videoFrame.p_data = const_cast<uint8_t*>( mData + entry.offset );
+	videoFrame.line_stride_in_bytes = entry.lineStride;
+	videoFrame.p_metadata = getMetadata( index );
+	return videoFrame;
+}
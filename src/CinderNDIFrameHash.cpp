@@ -0,0 +1,151 @@
+#include "CinderNDIFrameHash.h"
+
+#include <cstring>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define CINDER_NDI_HASH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const uint64_t kPrime64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime32_1 = 0x9E3779B1ULL;
+const uint64_t kKeyStep = 0x165667B19E3779F9ULL;	// added to every key per 64 byte block so moved content changes the hash
+const uint64_t kKeys[8] = {
+	0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+	0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL
+};
+
+inline uint64_t avalanche( uint64_t h )
+{
+	h ^= h >> 33;
+	h *= kPrime64_2;
+	h ^= h >> 29;
+	h *= kPrime64_1;
+	h ^= h >> 32;
+	return h;
+}
+
+inline uint64_t read64( const uint8_t* p )
+{
+	uint64_t v;
+	std::memcpy( &v, p, sizeof( v ) );
+	return v;
+}
+
+// acc[2i] += lo32(v0 ^ k0) * hi32(v0 ^ k0) + v1, acc[2i+1] likewise with v0/v1 swapped. Both paths compute exactly this.
+inline void accumulateScalar( uint64_t acc[8], const uint8_t* p, const uint64_t keys[8] )
+{
+	for( int i = 0; i < 8; i += 2 ) {
+		const uint64_t v0 = read64( p + i * 8 );
+		const uint64_t v1 = read64( p + i * 8 + 8 );
+		const uint64_t dk0 = v0 ^ keys[i];
+		const uint64_t dk1 = v1 ^ keys[i + 1];
+		acc[i] += ( dk0 & 0xFFFFFFFFULL ) * ( dk0 >> 32 ) + v1;
+		acc[i + 1] += ( dk1 & 0xFFFFFFFFULL ) * ( dk1 >> 32 ) + v0;
+	}
+}
+
+inline void scrambleScalar( uint64_t acc[8] )
+{
+	for( int i = 0; i < 8; ++i ) {
+		acc[i] = ( acc[i] ^ ( acc[i] >> 47 ) ^ kKeys[i] ) * kPrime32_1;
+	}
+}
+
+#if CINDER_NDI_HASH_SSE2
+inline __m128i accumulateLane( __m128i acc, __m128i v, __m128i key )
+{
+	const __m128i dk = _mm_xor_si128( v, key );
+	const __m128i dkHi = _mm_shuffle_epi32( dk, _MM_SHUFFLE( 0, 3, 0, 1 ) );
+	const __m128i product = _mm_mul_epu32( dk, dkHi );
+	const __m128i swapped = _mm_shuffle_epi32( v, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+	return _mm_add_epi64( acc, _mm_add_epi64( product, swapped ) );
+}
+
+inline __m128i scrambleLane( __m128i acc, __m128i key )
+{
+	const __m128i prime = _mm_set1_epi32( (int)kPrime32_1 );
+	acc = _mm_xor_si128( _mm_xor_si128( acc, _mm_srli_epi64( acc, 47 ) ), key );
+	// 64x32 bit multiply from two 32x32 products.
+	const __m128i lo = _mm_mul_epu32( acc, prime );
+	const __m128i hi = _mm_mul_epu32( _mm_shuffle_epi32( acc, _MM_SHUFFLE( 2, 3, 0, 1 ) ), prime );
+	return _mm_add_epi64( lo, _mm_slli_epi64( hi, 32 ) );
+}
+#endif
+
+} // anonymous namespace
+
+uint64_t CinderNDIFrameHash::calc( const uint8_t* data, size_t rowBytes, int rows, ptrdiff_t stride, uint64_t seed )
+{
+	uint64_t acc[8];
+	for( int i = 0; i < 8; ++i ) {
+		acc[i] = kKeys[i] ^ seed;
+	}
+
+	const size_t blocks = rowBytes / 64;
+	const size_t tail = rowBytes % 64;
+
+#if CINDER_NDI_HASH_SSE2
+	__m128i vacc[4], vkeyBase[4];
+	for( int i = 0; i < 4; ++i ) {
+		vacc[i] = _mm_loadu_si128( (const __m128i*)( acc + i * 2 ) );
+		vkeyBase[i] = _mm_loadu_si128( (const __m128i*)( kKeys + i * 2 ) );
+	}
+	const __m128i vkeyStep = _mm_set1_epi64x( (long long)kKeyStep );
+#endif
+
+	for( int y = 0; y < rows; ++y ) {
+		const uint8_t* row = data + (ptrdiff_t)y * stride;
+
+#if CINDER_NDI_HASH_SSE2
+		__m128i vkey[4] = { vkeyBase[0], vkeyBase[1], vkeyBase[2], vkeyBase[3] };
+		for( size_t b = 0; b < blocks; ++b ) {
+			const __m128i* p = (const __m128i*)( row + b * 64 );
+			for( int i = 0; i < 4; ++i ) {
+				vacc[i] = accumulateLane( vacc[i], _mm_loadu_si128( p + i ), vkey[i] );
+				vkey[i] = _mm_add_epi64( vkey[i], vkeyStep );
+			}
+		}
+		for( int i = 0; i < 4; ++i ) {
+			vacc[i] = scrambleLane( vacc[i], vkeyBase[i] );
+		}
+#else
+		uint64_t keys[8];
+		std::memcpy( keys, kKeys, sizeof( keys ) );
+		for( size_t b = 0; b < blocks; ++b ) {
+			accumulateScalar( acc, row + b * 64, keys );
+			for( int i = 0; i < 8; ++i ) {
+				keys[i] += kKeyStep;
+			}
+		}
+		scrambleScalar( acc );
+#endif
+
+		if( tail ) {
+			uint8_t block[64] = {};
+			std::memcpy( block, row + blocks * 64, tail );
+#if CINDER_NDI_HASH_SSE2
+			for( int i = 0; i < 4; ++i ) {
+				vacc[i] = accumulateLane( vacc[i], _mm_loadu_si128( (const __m128i*)block + i ), vkeyBase[i] );
+			}
+#else
+			accumulateScalar( acc, block, kKeys );
+#endif
+		}
+	}
+
+#if CINDER_NDI_HASH_SSE2
+	for( int i = 0; i < 4; ++i ) {
+		_mm_storeu_si128( (__m128i*)( acc + i * 2 ), vacc[i] );
+	}
+#endif
+
+	uint64_t h = seed ^ ( (uint64_t)rowBytes * kPrime64_1 ) ^ ( (uint64_t)rows * kPrime64_2 );
+	for( int i = 0; i < 8; ++i ) {
+		h = ( h ^ avalanche( acc[i] ) ) * kPrime64_1 + kKeys[i];
+	}
+	return avalanche( h );
+}
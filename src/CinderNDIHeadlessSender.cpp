@@ -0,0 +1,112 @@
+#include "CinderNDIHeadlessSender.h"
+
+#include "cinder/Log.h"
+
+CinderNDIHeadlessSender::CinderNDIHeadlessSender( const std::string name, int width, int height, NDIlib_FourCC_type_e fourCC, size_t ringSize )
+	: mSender{ name }, mWidth{ width }, mHeight{ height }, mFourCC{ fourCC }, mRingIndex{ 0 },
+	mClockNumerator{ 0 }, mClockDenominator{ 0 }, mFrameIndex{ 0 }
+{
+	mRunning = false;
+	mNumFramesSent = 0;
+	mNumFramesSkipped = 0;
+
+	mStride = CinderNDISender::calcLineStride( mWidth, mFourCC );
+	if( ! mStride ) {
+		CI_LOG_E( "Unsupported FourCC for headless NDI sender '" << name << "', falling back to BGRX" );
+		mFourCC = NDIlib_FourCC_type_BGRX;
+		mStride = CinderNDISender::calcLineStride( mWidth, mFourCC );
+	}
+
+	// An async send keeps the previous buffer in use until the next send, so we need at least two slots.
+	if( ringSize < 2 ) {
+		ringSize = 2;
+	}
+	for( size_t i = 0; i < ringSize; ++i ) {
+		mRing.emplace_back( new uint8_t[ (size_t)mStride * mHeight ]() );
+	}
+}
+
+CinderNDIHeadlessSender::~CinderNDIHeadlessSender()
+{
+	stop();
+}
+
+void CinderNDIHeadlessSender::setFramerate( int numerator, int denominator )
+{
+	mSender.setFramerate( numerator, denominator );
+}
+
+void CinderNDIHeadlessSender::setProducer( const ProducerFn& producer )
+{
+	if( mRunning ) {
+		CI_LOG_W( "Can't change the producer of a running headless NDI sender" );
+		return;
+	}
+	mProducer = producer;
+}
+
+void CinderNDIHeadlessSender::start()
+{
+	if( mRunning ) {
+		return;
+	}
+	mRunning = true;
+	mClockNumerator = mSender.getFramerateNumerator();
+	mClockDenominator = mSender.getFramerateDenominator();
+	mClock.setRate( mClockNumerator, mClockDenominator );
+	mFrameIndex = 0;
+	if( ! mThreadPool ) {
+		mThreadPool = CinderNDIThreadPool::getDefault();
+	}
+	mSendJob = mThreadPool->startJob( "NDI headless " + mSender.getName(), [this] { return send(); }, true );
+}
+
+void CinderNDIHeadlessSender::stop()
+{
+	mRunning = false;
+	if( mSendJob ) {
+		mThreadPool->stopJob( mSendJob );
+		mSendJob.reset();
+		// release the last async frame before the ring can go away.
+		mSender.sendSurfaceForceSync();
+	}
+}
+
+CinderNDIThreadPool::Clock::time_point CinderNDIHeadlessSender::send()
+{
+	if( mClockNumerator != mSender.getFramerateNumerator() || mClockDenominator != mSender.getFramerateDenominator() ) {
+		mClockNumerator = mSender.getFramerateNumerator();
+		mClockDenominator = mSender.getFramerateDenominator();
+		mClock.setRate( mClockNumerator, mClockDenominator );
+	}
+	// ticks missed while the producer was busy are skipped rather than burst out.
+	mNumFramesSkipped += mClock.waitForNextTick();
+	const auto next = mClock.getNextWakeTime();
+
+	// nothing is produced for ticks nobody would see.
+	if( ! mSender.shouldSendFrame() ) {
+		return next;
+	}
+
+	Frame frame = { mRing[mRingIndex].get(), mWidth, mHeight, mStride, mFourCC, NDIlib_send_timecode_synthesize, mFrameIndex++ };
+	if( ! mProducer || ! mProducer( frame ) ) {
+		++mNumFramesSkipped;
+		return next;
+	}
+
+	NDIlib_video_frame_v2_t NDI_video_frame;
+	NDI_video_frame.xres = mWidth;
+	NDI_video_frame.yres = mHeight;
+	NDI_video_frame.FourCC = mFourCC;
+	NDI_video_frame.frame_format_type = NDIlib_frame_format_type_progressive;
+	NDI_video_frame.timecode = frame.timecode;
+	NDI_video_frame.p_data = frame.data;
+	NDI_video_frame.line_stride_in_bytes = mStride;
+
+	// only advance the ring once NDI owns the slot, an unsent slot can be overwritten on the next tick.
+	if( mSender.sendVideoFrame( NDI_video_frame, true ) ) {
+		mRingIndex = ( mRingIndex + 1 ) % mRing.size();
+		++mNumFramesSent;
+	}
+	return next;
+}
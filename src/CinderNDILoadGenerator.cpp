@@ -0,0 +1,238 @@
+#include "CinderNDILoadGenerator.h"
+
+#include <chrono>
+#include <algorithm>
+
+#include "cinder/Log.h"
+
+#include "CinderNDIConvert.h"
+
+namespace {
+
+// enough distinct frames that the encoder can't settle into a static picture.
+const size_t kNumPatterns = 8;
+
+} // anonymous namespace
+
+CinderNDILoadGenerator::CinderNDILoadGenerator( int width, int height, NDIlib_FourCC_type_e fourCC )
+	: mWidth{ width }, mHeight{ height }, mFourCC{ fourCC }, mFramerateNumerator{ 60000 }, mFramerateDenominator{ 1001 }
+{
+	mRunning = false;
+	mTicksMissed = 0;
+	mStartTime = 0;
+
+	if( fourCC != NDIlib_FourCC_type_BGRX && fourCC != NDIlib_FourCC_type_BGRA && fourCC != NDIlib_FourCC_type_UYVY ) {
+		CI_LOG_E( "Unsupported FourCC for the NDI load generator, falling back to BGRX" );
+		mFourCC = NDIlib_FourCC_type_BGRX;
+	}
+	if( mWidth < 1 || mHeight < 1 ) {
+		CI_LOG_E( "Invalid size " << mWidth << "x" << mHeight << " for the NDI load generator, using 1x1" );
+		mWidth = std::max( 1, mWidth );
+		mHeight = std::max( 1, mHeight );
+	}
+}
+
+CinderNDILoadGenerator::~CinderNDILoadGenerator()
+{
+	stop();
+}
+
+void CinderNDILoadGenerator::setFramerate( int numerator, int denominator )
+{
+	if( mRunning ) {
+		CI_LOG_W( "Can't change the framerate of a running NDI load generator" );
+		return;
+	}
+	mFramerateNumerator = numerator;
+	mFramerateDenominator = denominator;
+	for( auto& state : mSenders ) {
+		state->sender->setFramerate( numerator, denominator );
+	}
+}
+
+bool CinderNDILoadGenerator::setReplayFile( const std::string& path )
+{
+	if( mRunning ) {
+		CI_LOG_W( "Can't change the replay file of a running NDI load generator" );
+		return false;
+	}
+	if( ! mReplayFile.open( path ) ) {
+		return false;
+	}
+	if( mReplayFile.getNumFrames() == 0 ) {
+		CI_LOG_E( "NDI frame file '" << path << "' has no frames to replay" );
+		mReplayFile.close();
+		return false;
+	}
+	return true;
+}
+
+void CinderNDILoadGenerator::addSenders( const std::string& baseName, size_t count )
+{
+	if( mRunning ) {
+		CI_LOG_W( "Can't add senders to a running NDI load generator" );
+		return;
+	}
+	for( size_t i = 0; i < count; ++i ) {
+		std::unique_ptr<SenderState> state( new SenderState );
+		state->sender.reset( new CinderNDISender( baseName + " " + std::to_string( mSenders.size() + 1 ) ) );
+		state->sender->setFramerate( mFramerateNumerator, mFramerateDenominator );
+		state->framesSent = 0;
+		state->latencyNanosTotal = 0;
+		state->latencyNanosMax = 0;
+		mSenders.push_back( std::move( state ) );
+	}
+}
+
+void CinderNDILoadGenerator::start()
+{
+	if( mRunning ) {
+		return;
+	}
+	if( ! mReplayFile.isOpen() && mPatterns.empty() ) {
+		generatePatterns();
+	}
+
+	for( auto& state : mSenders ) {
+		state->framesSent = 0;
+		state->latencyNanosTotal = 0;
+		state->latencyNanosMax = 0;
+	}
+	mTicksMissed = 0;
+	mStartTime = std::chrono::steady_clock::now().time_since_epoch().count();
+	mRunning = true;
+	mClock.setRate( mFramerateNumerator, mFramerateDenominator );
+	if( ! mThreadPool ) {
+		mThreadPool = CinderNDIThreadPool::getDefault();
+	}
+	mSendJob = mThreadPool->startJob( "NDI load generator", [this] { return send(); }, true );
+}
+
+void CinderNDILoadGenerator::stop()
+{
+	mRunning = false;
+	if( mSendJob ) {
+		mThreadPool->stopJob( mSendJob );
+		mSendJob.reset();
+		for( auto& state : mSenders ) {
+			state->sender->sendSurfaceForceSync();
+		}
+	}
+}
+
+void CinderNDILoadGenerator::generatePatterns()
+{
+	// a horizontal gradient with a bar sweeping across it, drawn in BGRA and converted when needed.
+	const int bgraStride = mWidth * 4;
+	std::vector<uint8_t> bgra( (size_t)bgraStride * mHeight );
+	const int stride = CinderNDISender::calcLineStride( mWidth, mFourCC );
+	const int barWidth = std::max( 1, mWidth / 16 );
+
+	mPatterns.resize( kNumPatterns );
+	for( size_t i = 0; i < kNumPatterns; ++i ) {
+		const int barStart = (int)( i * ( mWidth - barWidth ) / ( kNumPatterns - 1 ) );
+		for( int y = 0; y < mHeight; ++y ) {
+			uint8_t* row = bgra.data() + (size_t)y * bgraStride;
+			for( int x = 0; x < mWidth; ++x ) {
+				const bool bar = x >= barStart && x < barStart + barWidth;
+				row[x * 4 + 0] = bar ? 255 : (uint8_t)( ( y * 255 ) / std::max( 1, mHeight - 1 ) );
+				row[x * 4 + 1] = bar ? 255 : (uint8_t)( ( x * 255 ) / std::max( 1, mWidth - 1 ) );
+				row[x * 4 + 2] = bar ? 255 : (uint8_t)( ( ( x + y + (int)i * 32 ) * 255 ) / std::max( 1, mWidth + mHeight ) );
+				row[x * 4 + 3] = 255;
+			}
+		}
+
+		auto& pattern = mPatterns[i];
+		if( mFourCC == NDIlib_FourCC_type_UYVY ) {
+			// the stride covers a whole pixel pair for the last pixel of an odd width, as the conversion writes it.
+			pattern.resize( (size_t)stride * mHeight );
+			CinderNDIConvert::bgraToUYVY( bgra.data(), bgraStride, mWidth, mHeight, pattern.data(), stride );
+		}
+		else {
+			pattern = bgra;
+		}
+	}
+}
+
+NDIlib_video_frame_v2_t CinderNDILoadGenerator::getFrame( uint64_t index ) const
+{
+	if( mReplayFile.isOpen() ) {
+		NDIlib_video_frame_v2_t videoFrame = mReplayFile.getVideoFrame( (size_t)( index % mReplayFile.getNumFrames() ) );
+		videoFrame.frame_rate_N = mFramerateNumerator;
+		videoFrame.frame_rate_D = mFramerateDenominator;
+		videoFrame.timecode = NDIlib_send_timecode_synthesize;
+		return videoFrame;
+	}
+
+	NDIlib_video_frame_v2_t videoFrame;
+	videoFrame.xres = mWidth;
+	videoFrame.yres = mHeight;
+	videoFrame.FourCC = mFourCC;
+	videoFrame.frame_rate_N = mFramerateNumerator;
+	videoFrame.frame_rate_D = mFramerateDenominator;
+	videoFrame.frame_format_type = NDIlib_frame_format_type_progressive;
+	videoFrame.p_data = const_cast<uint8_t*>( mPatterns[index % mPatterns.size()].data() );
+	videoFrame.line_stride_in_bytes = CinderNDISender::calcLineStride( mWidth, mFourCC );
+	return videoFrame;
+}
+
+CinderNDIThreadPool::Clock::time_point CinderNDILoadGenerator::send()
+{
+	mTicksMissed += mClock.waitForNextTick();
+	const uint64_t tick = mClock.getTickCount();
+
+	for( size_t i = 0; i < mSenders.size(); ++i ) {
+		auto& state = *mSenders[i];
+		// offset every sender so they don't all carry the same picture.
+		NDIlib_video_frame_v2_t videoFrame = getFrame( tick + i );
+
+		auto begin = std::chrono::steady_clock::now();
+		// the frames are never written, so an async send can keep reading them for as long as it likes.
+		if( ! state.sender->sendVideoFrame( videoFrame, true ) ) {
+			continue;
+		}
+		uint64_t latency = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - begin ).count();
+
+		++state.framesSent;
+		state.latencyNanosTotal += latency;
+		if( latency > state.latencyNanosMax ) {
+			state.latencyNanosMax = latency;
+		}
+	}
+	return mClock.getNextWakeTime();
+}
+
+CinderNDILoadGenerator::Stats CinderNDILoadGenerator::getStats( size_t index ) const
+{
+	const auto& state = *mSenders[index];
+	const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration( mStartTime ) ).count();
+
+	Stats stats;
+	stats.framesSent = state.framesSent;
+	stats.ticksMissed = mTicksMissed;
+	stats.framesPerSecond = seconds > 0.0 ? stats.framesSent / seconds : 0.0;
+	stats.meanSendLatency = stats.framesSent ? state.latencyNanosTotal * 1e-9 / stats.framesSent : 0.0;
+	stats.maxSendLatency = state.latencyNanosMax * 1e-9;
+	return stats;
+}
+
+CinderNDILoadGenerator::Stats CinderNDILoadGenerator::getTotalStats() const
+{
+	Stats total = {};
+	total.ticksMissed = mTicksMissed;
+	if( mSenders.empty() ) {
+		return total;
+	}
+
+	uint64_t latencyNanosTotal = 0;
+	for( size_t i = 0; i < mSenders.size(); ++i ) {
+		Stats stats = getStats( i );
+		total.framesSent += stats.framesSent;
+		total.framesPerSecond += stats.framesPerSecond;
+		total.maxSendLatency = std::max( total.maxSendLatency, stats.maxSendLatency );
+		latencyNanosTotal += mSenders[i]->latencyNanosTotal;
+	}
+	total.framesPerSecond /= mSenders.size();
+	total.meanSendLatency = total.framesSent ? latencyNanosTotal * 1e-9 / total.framesSent : 0.0;
+	return total;
+}
@@ -0,0 +1,108 @@
+#include "CinderNDIReadback.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "cinder/Log.h"
+
+CinderNDIReadback::CinderNDIReadback( int width, int height )
+	: mWidth{ width }, mHeight{ height }, mWriteIndex{ 0 }, mNumBytesReadBack{ 0 }
+{
+	mSurface = ci::Surface8u::create( mWidth, mHeight, true, ci::SurfaceChannelOrder::BGRA );
+	std::memset( mSurface->getData(), 0, mSurface->getRowBytes() * mHeight );
+
+	for( int i = 0; i < 2; ++i ) {
+		mPbo[i] = ci::gl::Pbo::create( GL_PIXEL_PACK_BUFFER, mWidth * mHeight * 4, nullptr, GL_STREAM_READ );
+	}
+	markAllDirty();
+}
+
+void CinderNDIReadback::addDirtyArea( const ci::Area& area )
+{
+	ci::Area clipped = area;
+	clipped.clipBy( ci::Area( 0, 0, mWidth, mHeight ) );
+	if( clipped.getWidth() > 0 && clipped.getHeight() > 0 ) {
+		mDirtyAreas.push_back( clipped );
+	}
+}
+
+void CinderNDIReadback::markAllDirty()
+{
+	mDirtyAreas.assign( 1, ci::Area( 0, 0, mWidth, mHeight ) );
+}
+
+bool CinderNDIReadback::readback( const ci::gl::FboRef& fbo )
+{
+	if( fbo->getWidth() != mWidth || fbo->getHeight() != mHeight ) {
+		CI_LOG_E( "Readback size " << mWidth << "x" << mHeight << " doesn't match the Fbo" );
+		return false;
+	}
+
+	// many small areas cost more in transfer setup than reading the whole frame once.
+	int64_t dirtyPixels = 0;
+	for( const auto& area : mDirtyAreas ) {
+		dirtyPixels += area.calcArea();
+	}
+	if( dirtyPixels * 2 >= (int64_t)mWidth * mHeight ) {
+		markAllDirty();
+	}
+
+	auto& pending = mPboAreas[mWriteIndex];
+	pending.clear();
+	if( ! mDirtyAreas.empty() ) {
+		ci::gl::ScopedFramebuffer scopedFbo( fbo, GL_READ_FRAMEBUFFER );
+		ci::gl::ScopedBuffer scopedPbo( mPbo[mWriteIndex] );
+		ci::gl::readBuffer( GL_COLOR_ATTACHMENT0 );
+		// each area lands at its own position inside a full-frame sized PBO.
+		glPixelStorei( GL_PACK_ROW_LENGTH, mWidth );
+		for( const auto& area : mDirtyAreas ) {
+			ci::Area glArea( area.x1, mHeight - area.y2, area.x2, mHeight - area.y1 );
+			size_t offset = ( (size_t)glArea.y1 * mWidth + glArea.x1 ) * 4;
+			ci::gl::readPixels( glArea.x1, glArea.y1, glArea.getWidth(), glArea.getHeight(), GL_BGRA, GL_UNSIGNED_BYTE, (void*)offset );
+			pending.push_back( glArea );
+			mNumBytesReadBack += (uint64_t)glArea.calcArea() * 4;
+		}
+		glPixelStorei( GL_PACK_ROW_LENGTH, 0 );
+		mDirtyAreas.clear();
+	}
+
+	mWriteIndex = 1 - mWriteIndex;
+	bool changed = ! mPboAreas[mWriteIndex].empty();
+	resolve( mWriteIndex );
+	return changed;
+}
+
+void CinderNDIReadback::resolve( size_t index )
+{
+	auto& areas = mPboAreas[index];
+	if( areas.empty() ) {
+		return;
+	}
+
+	// map only the rows that were written.
+	int y1 = mHeight, y2 = 0;
+	for( const auto& area : areas ) {
+		y1 = std::min( y1, area.y1 );
+		y2 = std::max( y2, area.y2 );
+	}
+	const size_t rowBytes = (size_t)mWidth * 4;
+	const size_t mapOffset = y1 * rowBytes;
+	auto mapped = (const uint8_t*)mPbo[index]->mapBufferRange( mapOffset, ( y2 - y1 ) * rowBytes, GL_MAP_READ_BIT );
+	if( ! mapped ) {
+		CI_LOG_E( "Failed to map readback PBO" );
+		areas.clear();
+		return;
+	}
+
+	uint8_t* dst = mSurface->getData();
+	const ptrdiff_t dstRowBytes = mSurface->getRowBytes();
+	for( const auto& area : areas ) {
+		const size_t bytes = (size_t)area.getWidth() * 4;
+		for( int y = area.y1; y < area.y2; ++y ) {
+			std::memcpy( dst + y * dstRowBytes + area.x1 * 4, mapped + y * rowBytes - mapOffset + area.x1 * 4, bytes );
+		}
+	}
+
+	mPbo[index]->unmap();
+	areas.clear();
+}
@@ -1,12 +1,32 @@
 #include "CinderNDIReceiver.h"
 #include <cstdio>
+#include <cstring>
 #include <chrono>
+#include <algorithm>
+#include <cmath>
 
 #include "cinder/Log.h"
 #include "cinder/Surface.h"
 #include <Processing.NDI.Recv.h>
 
-CinderNDIReceiver::CinderNDIReceiver() : mNdiSources{ nullptr } {
+#include "CinderNDIConvert.h"
+
+namespace {
+
+// How long the capture job waits inside NDI for a frame. It only bounds how long a reconnect waits, NDI
+// returns as soon as a frame arrives.
+const uint32_t kCaptureTimeoutMs = 100;
+// How long the capture job waits after finding nothing when no blocking thread was left for it.
+const std::chrono::milliseconds kCapturePollInterval( 1 );
+// Frames taken per run before the job lets others run.
+const int kMaxFramesPerCapture = 8;
+// Audio and metadata frames update() may fall behind by before newer ones are dropped.
+const size_t kMaxCapturedFrames = 64;
+
+} // anonymous namespace
+
+CinderNDIReceiver::CinderNDIReceiver()
+	: mCapturedAudio{ kMaxCapturedFrames }, mCapturedMetadata{ kMaxCapturedFrames }, mNdiReceiver{ nullptr }, mDiscoveryListener{ 0 } {
 	if( ! NDIlib_is_supported_CPU() ) {
 		CI_LOG_E( "Failed to initialize NDI because of unsupported CPU!" );
 	}
@@ -15,24 +35,51 @@ CinderNDIReceiver::CinderNDIReceiver() : mNdiSources{ nullptr } {
 		CI_LOG_E( "Failed to initialize NDI!" );
 	}
 
-	mNdiFinder = NDIlib_find_create_v2();
-	if( !mNdiFinder ) {
-		CI_LOG_E( "Failed to create NDI finder!" );
-	}
-	
 	mCurrentIndex = -1;
 	mNdiInitialized = true;
 	mReady = false;
 	mConnecting = false;
-	mQuitSourceFindingThread = false;
+	mInterlaced = false;
+	mPendingField = -1;
+	mPendingFieldTimecode = 0;
+	mRemoteRecording = false;
+	mTextureUploadEnabled = true;
+	mUsage = Usage::Program;
+	mBandwidth = NDIlib_recv_bandwidth_highest;
+	mHiddenBandwidth = NDIlib_recv_bandwidth_lowest;
+	mHiddenDelay = 2.0;
+	mHasDeferredFrame = false;
+	mHasPendingSource = false;
+	mPrimaryReturned = false;
+	mCaptureThreadEnabled = false;
+	mCaptureAudio = false;
+
+	mState = State::Searching;
+	mMatchMode = CinderNDISourceMatcher::Mode::Exact;
+	mPrimaryMatchMode = CinderNDISourceMatcher::Mode::Exact;
+	mBackupMatchMode = CinderNDISourceMatcher::Mode::Exact;
+	mFailoverAttempts = 2;
+	mOnBackup = false;
+	mSourceLost = false;
+	mStallTimeout = 2.0;
+	mReconnectBackoff = 0.5;
+	mMaxReconnectBackoff = 8.0;
+	mReconnectAttempts = 0;
 }
 
 CinderNDIReceiver::~CinderNDIReceiver()
 {
+	// waits for a source event being handled right now, none arrive afterwards.
+	if( mDiscovery && mDiscoveryListener ) {
+		mDiscovery->removeListener( mDiscoveryListener );
+	}
+	if( mUploadScheduler ) {
+		mUploadScheduler->removeReceiver( this );
+	}
+
+	stopCapture();
+
 	if (mNdiInitialized) {
-		if (mNdiFinder) {
-			NDIlib_find_destroy(mNdiFinder);
-		}
 		if (mNdiReceiver) {
 			NDIlib_recv_destroy(mNdiReceiver);
 		}
@@ -40,14 +87,9 @@ CinderNDIReceiver::~CinderNDIReceiver()
 		NDIlib_destroy();
 		mNdiInitialized = false;
 	}
-
-	if (mSourceFindingThread) {
-		mQuitSourceFindingThread = true;
-		mSourceFindingThread->join();
-	}
 }
 
-void CinderNDIReceiver::setup(std::string name) {
+void CinderNDIReceiver::setup(std::string name, CinderNDISourceMatcher::Mode matchMode) {
 	// only the first instance will be verbose
 	static bool firstInstance = true;
 	mVerbose = firstInstance;
@@ -56,22 +98,32 @@ void CinderNDIReceiver::setup(std::string name) {
 	}
 
 	mPreferredSenderName = name;
+	mMatchMode = matchMode;
+	mPrimarySenderName = name;
+	mPrimaryMatchMode = matchMode;
 	if (shouldWaitForPreferredSender()) {
 		CI_LOG_I("Started NDI input stream for sender with name " << mPreferredSenderName);
 	}
 
-	mSourceFindingThread = std::unique_ptr<std::thread>(new std::thread(&CinderNDIReceiver::threadedSourceFind, this));
+	if( ! mDiscovery ) {
+		mDiscovery = CinderNDIDiscovery::getDefault();
+	}
+	if( mDiscoveryListener ) {
+		mDiscovery->removeListener( mDiscoveryListener );
+	}
+	// replays the sources already known, so a preferred sender that is up connects on the next update().
+	mDiscoveryListener = mDiscovery->addListener( [this]( CinderNDIDiscovery::Event event, const CinderNDIDiscovery::Source& source ) {
+		onSourceEvent( event, source );
+	} );
 }
 
 int CinderNDIReceiver::getIndexForSender(std::string name) {
 	if (name.empty()) return -1;
 
-	if (mNDIsenderNames.size() > 0) {
-		for (int i = 0; i<(int)mNDIsenderNames.size(); i++) {
-			std::string test = mNDIsenderNames.at(i);
-			if (test.find(name) != std::string::npos) {
-				return i;
-			}
+	std::lock_guard<std::mutex> lock( mSourcesMutex );
+	for (int i = 0; i<(int)mSources.size(); i++) {
+		if (CinderNDISourceMatcher::matches(mMatchMode, name, mSources[i])) {
+			return i;
 		}
 	}
 	return -1;
@@ -88,102 +140,164 @@ bool CinderNDIReceiver::shouldWaitForPreferredSender() {
 }
 
 void CinderNDIReceiver::initConnection(int index) {
+	CinderNDIDiscovery::Source source;
+	{
+		std::lock_guard<std::mutex> lock( mSourcesMutex );
+		if( index < 0 || index >= (int)mSources.size() ) {
+			return;
+		}
+		source = mSources[index];
+		// a source picked by hand is the one the watchdog returns to.
+		mPrimarySenderName = source.name;
+		mPrimaryMatchMode = CinderNDISourceMatcher::Mode::MachineAndName;
+	}
+	connect( source );
+}
+
+void CinderNDIReceiver::connect( const CinderNDIDiscovery::Source& source, bool backup ) {
 	mReady = false;
 	mConnecting = true;
 
-	if (index != mCurrentIndex) {
-		mCurrentIndex = index;
-	}
-	if( mNdiSources ) {
-
-		if (mNdiReceiver) {
-			NDIlib_recv_destroy(mNdiReceiver);
+	{
+		std::lock_guard<std::mutex> lock( mSourcesMutex );
+		mCurrentSource = source;
+		// a source picked here supersedes one the discovery asked for before.
+		mHasPendingSource = false;
+		mOnBackup = backup;
+		if( mPrimarySenderName.empty() && ! backup ) {
+			mPrimarySenderName = source.name;
+			mPrimaryMatchMode = CinderNDISourceMatcher::Mode::MachineAndName;
 		}
+		mCurrentIndex = -1;
+		for( size_t i = 0; i < mSources.size(); ++i ) {
+			if( mSources[i].name == source.name ) {
+				mCurrentIndex = (int)i;
+			}
+		}
+	}
 
-		NDIlib_recv_create_v3_t NDI_recv_create_desc;
-		NDI_recv_create_desc.source_to_connect_to = mNdiSources[index];
-		NDI_recv_create_desc.color_format = NDIlib_recv_color_format_BGRX_BGRA;
-		NDI_recv_create_desc.bandwidth = NDIlib_recv_bandwidth_highest;
-		NDI_recv_create_desc.allow_video_fields = true;
+	stopCapture();
+	if (mNdiReceiver) {
+		NDIlib_recv_destroy(mNdiReceiver);
+		mNdiReceiver = nullptr;
+	}
 
-		mNdiReceiver = NDIlib_recv_create_v3(&NDI_recv_create_desc);
-		if(!mNdiReceiver) {
-			CI_LOG_E("Failed to create NDI receiver!");
-			mConnecting = false;
-			return;
-		}
-		else {
-			CI_LOG_I("Connected to sender at index #" << std::to_string(index) << " OK");
-		}
+	NDIlib_recv_create_v3_t NDI_recv_create_desc;
+	NDI_recv_create_desc.source_to_connect_to = NDIlib_source_t( source.name.c_str(), source.url.empty() ? NULL : source.url.c_str() );
+	NDI_recv_create_desc.color_format = NDIlib_recv_color_format_BGRX_BGRA;
+	NDI_recv_create_desc.bandwidth = mBandwidth;
+	NDI_recv_create_desc.allow_video_fields = true;
 
-		const NDIlib_tally_t tally_state = { true, false };
-		NDIlib_recv_set_tally( mNdiReceiver, &tally_state);
+	mDeinterlacer.reset();
+	mPendingField = -1;
+	mHasDeferredFrame = false;
 
-		mReady = true;
+	mNdiReceiver = NDIlib_recv_create_v3(&NDI_recv_create_desc);
+	if(!mNdiReceiver) {
+		CI_LOG_E("Failed to create NDI receiver!");
 		mConnecting = false;
+		return;
+	}
+	else {
+		CI_LOG_I("Connected to NDI source '" << source.name << "' OK");
+	}
+
+	sendTally();
+	if( mCaptureThreadEnabled ) {
+		startCapture();
 	}
+
+	// the new connection gets a full stall timeout to deliver its first frame.
+	mLastVideoTime = std::chrono::steady_clock::now();
+	mSourceLost = false;
+	mReady = true;
+	mConnecting = false;
 }
 
-void CinderNDIReceiver::threadedSourceFind() {
-	while (!mQuitSourceFindingThread) {
-		if (mConnecting) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(100));
-			continue;
+void CinderNDIReceiver::onSourceEvent( CinderNDIDiscovery::Event event, const CinderNDIDiscovery::Source& source ) {
+	bool connectNow = false;
+	{
+		std::lock_guard<std::mutex> lock( mSourcesMutex );
+		auto it = std::find_if( mSources.begin(), mSources.end(), [&source]( const CinderNDIDiscovery::Source& known ) { return known.name == source.name; } );
+		if( event == CinderNDIDiscovery::Event::Removed ) {
+			if( it != mSources.end() ) {
+				mSources.erase( it );
+			}
 		}
-		// check if sources have changed (blocking for maximum of 1 second)
-		if (!NDIlib_find_wait_for_sources(mNdiFinder, 1000)) {
-			continue;
+		else if( it != mSources.end() ) {
+			*it = source;
 		}
 		else {
-			if(mVerbose) CI_LOG_I("NDI sources changed");
+			mSources.push_back( source );
 		}
 
-		// get sources list
-		uint32_t nSources = 0;
-		mNdiSources = NDIlib_find_get_current_sources(mNdiFinder, &nSources);
-
-		if (mReady) {	// we are connected to a source so we can sleep for a while
-			std::this_thread::sleep_for(std::chrono::milliseconds(100));
-			continue;
-		}
-		
-		if (nSources == 0) {
-			if (mVerbose) CI_LOG_I("No NDI sources found - looking for " << (shouldWaitForPreferredSender() ? mPreferredSenderName : "any stream"));
-			continue;
+		// the list stays live while connected, so the index of the current source can move.
+		mCurrentIndex = -1;
+		for( size_t i = 0; i < mSources.size(); ++i ) {
+			if( mSources[i].name == mCurrentSource.name ) {
+				mCurrentIndex = (int)i;
+			}
 		}
 
-		// cache names
-		mNDIsenderNames.clear();
-		for (uint32_t i = 0; i < nSources; i++) {
-			std::string name = mNdiSources[i].p_ndi_name;
-			mNDIsenderNames.push_back(mNdiSources[i].p_ndi_name);
+		const bool current = source.name == mCurrentSource.name;
+		const State state = mState;
+		if( event == CinderNDIDiscovery::Event::Removed ) {
+			if( current ) {
+				mSourceLost = true;
+			}
 		}
-
-		if (mVerbose) CI_LOG_I("Found NDI sources:");
-		for (auto name : mNDIsenderNames) {
-			if (mVerbose) CI_LOG_I("\t" << name);
+		else if( event == CinderNDIDiscovery::Event::Changed && current && mReady ) {
+			// the sender restarted somewhere else, follow it instead of waiting on the old address.
+			connectNow = true;
 		}
-
-		// if we have a preferred sender name, try to find it
-		if (shouldWaitForPreferredSender()) {
-			for (uint32_t i = 0; i < nSources; i++) {
-				if (mNDIsenderNames[i].find(mPreferredSenderName) != std::string::npos) {
-					CI_LOG_I("Found preferred NDI source '" << mPreferredSenderName << "', full source name: '" << mNDIsenderNames[i] << "'");
-					initConnection(i);
-					continue;
+		else if( isPrimarySource( source ) && ! mConnecting && ( mOnBackup || state == State::Stalled || state == State::Reconnecting ) ) {
+			// back from a failure, the watchdog returns to it without waiting for the next backoff step.
+			CI_LOG_I("NDI source '" << source.name << "' is back, reconnecting");
+			mPrimaryReturned = true;
+		}
+		else if( event != CinderNDIDiscovery::Event::Removed && ! mReady && ! mConnecting ) {
+			if (shouldWaitForPreferredSender()) {
+				if( CinderNDISourceMatcher::matches( mMatchMode, mPreferredSenderName, source ) ) {
+					CinderNDIDiscovery::Source match;
+					const auto result = mDiscovery->getMatcher()->find( mMatchMode, mPreferredSenderName, match );
+					connectNow = result == CinderNDISourceMatcher::Result::Found;
+					if (connectNow) {
+						CI_LOG_I("Found preferred NDI source '" << mPreferredSenderName << "', full source name: '" << source.name << "'");
+					}
+					else if( result == CinderNDISourceMatcher::Result::Ambiguous ) {
+						CI_LOG_W("NDI source name '" << mPreferredSenderName << "' matches several sources, not connecting until it is unique");
+					}
 				}
 			}
-
-			if (!mReady) {
-				CI_LOG_I("Did not find preferred NDI source '" << mPreferredSenderName << "'. Found " << nSources << " other sources");
+			else {
+				// the first source found wins, later ones don't replace it before update() connects.
+				if( ! mHasPendingSource ) {
+					CI_LOG_I("No NDI source preference, connecting to '" << source.name << "'");
+					connectNow = true;
+				}
 			}
 		}
-		else {
-			CI_LOG_I("No NDI source preference, connecting to '" << mNDIsenderNames[0] << "'");
 
-			initConnection(0);
+		// this runs on the discovery's thread while update() may be capturing, so the connection itself is
+		// left to update().
+		if( connectNow ) {
+			mPendingSource = source;
+			mHasPendingSource = true;
+		}
+	}
+}
+
+void CinderNDIReceiver::connectPendingSource() {
+	CinderNDIDiscovery::Source source;
+	{
+		std::lock_guard<std::mutex> lock( mSourcesMutex );
+		if( ! mHasPendingSource ) {
+			return;
 		}
+		source = mPendingSource;
+		mHasPendingSource = false;
 	}
+	connect( source );
 }
 
 bool CinderNDIReceiver::isReady() {
@@ -197,45 +311,536 @@ void CinderNDIReceiver::update()
 		return;
 	}
 
+	updateWatchdog();
 	if (!mReady) {
 		return;
 	}
 
-	NDIlib_video_frame_t video_frame;
+	updateBandwidth();
+	if( ! mReady ) {
+		return;
+	}
+
+	// the second field of an interleaved frame gets its own update so fielded sources play at field rate.
+	if( mPendingField >= 0 ) {
+		auto texture = mDeinterlacer.render( mPendingField );
+		if( texture ) {
+			mVideoTexture.first = texture;
+			mVideoTexture.second = mPendingFieldTimecode;
+		}
+		mPendingField = -1;
+		return;
+	}
+
+	if( mHasDeferredFrame && mTextureUploadEnabled ) {
+		const size_t bytes = (size_t)mDeferredFrame.xres * mDeferredFrame.yres * 4;
+		const auto decision = mUploadScheduler ? mUploadScheduler->schedule( bytes, getUploadPriority() ) : CinderNDIUploadScheduler::Decision::Upload;
+		if( decision == CinderNDIUploadScheduler::Decision::Upload ) {
+			uploadVideoFrame( mDeferredFrame );
+		}
+		// dropped when the receiver went to the background while the frame was waiting.
+		mHasDeferredFrame = decision == CinderNDIUploadScheduler::Decision::Defer;
+	}
+
+	if( mCaptureThreadEnabled ) {
+		receiveCapturedFrames();
+		return;
+	}
+
+	NDIlib_video_frame_v2_t video_frame;
+	NDIlib_audio_frame_v2_t audio_frame;
 	NDIlib_metadata_frame_t metadata_frame;
 
-	switch( NDIlib_recv_capture( mNdiReceiver, &video_frame, NULL, &metadata_frame, 0 ) ) {
-		// No data
-		case NDIlib_frame_type_none:
-		{
-			//CI_LOG_I( "No data received. " );
-			break;
+	bool capturing = true;
+	while( capturing ) {
+		switch( NDIlib_recv_capture_v2( mNdiReceiver, &video_frame, mAudioFrameCallback ? &audio_frame : NULL, &metadata_frame, 0 ) ) {
+			// No data
+			case NDIlib_frame_type_none:
+			{
+				//CI_LOG_I( "No data received. " );
+				capturing = false;
+				break;
+			}
+
+			// Video data
+			case NDIlib_frame_type_video:
+			{
+				//CI_LOG_I( "Video data received with width: " << video_frame.xres << " and height: " << video_frame.yres );
+				handleVideoFrame( video_frame );
+				NDIlib_recv_free_video_v2( mNdiReceiver, &video_frame );
+				// one video frame per update.
+				capturing = false;
+				break;
+			}
+
+			// Audio data
+			case NDIlib_frame_type_audio:
+			{
+				mAudioFrameCallback( audio_frame );
+				NDIlib_recv_free_audio_v2( mNdiReceiver, &audio_frame );
+				break;
+			}
+
+			// Meta data
+			case NDIlib_frame_type_metadata:
+			{
+				//CI_LOG_I( "Meta data received." );
+				handleMetadataFrame( metadata_frame );
+				NDIlib_recv_free_metadata( mNdiReceiver, &metadata_frame );
+				break;
+			}
+
+			default:
+				capturing = false;
+				break;
 		}
+	}
+}
 
-		// Video data
-		case NDIlib_frame_type_video:
-		{
-			//CI_LOG_I( "Video data received with width: " << video_frame.xres << " and height: " << video_frame.yres );
-			auto surface = ci::Surface::create( video_frame.p_data, video_frame.xres, video_frame.yres, video_frame.line_stride_in_bytes, ci::SurfaceChannelOrder::BGRA );
-			mVideoTexture.first = ci::gl::Texture::create( *surface );
-			mVideoTexture.first->setTopDown( false );
-			mVideoTexture.second = video_frame.timecode;
-			NDIlib_recv_free_video( mNdiReceiver, &video_frame );
-			break;
+void CinderNDIReceiver::handleVideoFrame( const NDIlib_video_frame_v2_t& videoFrame )
+{
+	mLastVideoTime = std::chrono::steady_clock::now();
+	if( mState != State::Connected && mState != State::FailedOver ) {
+		setState( mOnBackup ? State::FailedOver : State::Connected, "receiving video" );
+		mReconnectAttempts = 0;
+	}
+	else if( mState == State::FailedOver && ! mOnBackup ) {
+		setState( State::Connected, "back on the preferred source" );
+	}
+	mInterlaced = videoFrame.frame_format_type != NDIlib_frame_format_type_progressive;
+	mHasAlpha = videoFrame.FourCC == NDIlib_FourCC_type_BGRA;
+	if( mTextureUploadEnabled ) {
+		scheduleVideoFrame( videoFrame );
+	}
+	if( mRecorder.isRecording() ) {
+		mRecorder.addFrame( videoFrame );
+	}
+	if( mVideoFrameCallback ) {
+		mVideoFrameCallback( videoFrame );
+	}
+}
+
+void CinderNDIReceiver::handleMetadataFrame( const NDIlib_metadata_frame_t& metadataFrame )
+{
+	mMetadata.first = metadataFrame.p_data;
+	mMetadata.second = metadataFrame.timecode;
+	if( mMetadataFrameCallback ) {
+		mMetadataFrameCallback( metadataFrame );
+	}
+}
+
+void CinderNDIReceiver::setCaptureThreadEnabled( bool enabled )
+{
+	if( enabled == mCaptureThreadEnabled ) {
+		return;
+	}
+	mCaptureThreadEnabled = enabled;
+	if( enabled && mNdiReceiver ) {
+		startCapture();
+	}
+	else if( ! enabled ) {
+		stopCapture();
+	}
+}
+
+void CinderNDIReceiver::startCapture()
+{
+	if( mCaptureJob ) {
+		return;
+	}
+	if( ! mThreadPool ) {
+		mThreadPool = CinderNDIThreadPool::getDefault();
+	}
+	std::string name;
+	{
+		std::lock_guard<std::mutex> lock( mSourcesMutex );
+		name = mCurrentSource.name;
+	}
+	mCaptureJob = mThreadPool->startBlockingJob( "NDI capture " + name, [this]( bool mayBlock ) { return capture( mayBlock ); } );
+}
+
+void CinderNDIReceiver::stopCapture()
+{
+	if( ! mCaptureJob ) {
+		return;
+	}
+	mThreadPool->stopJob( mCaptureJob );
+	mCaptureJob.reset();
+}
+
+CinderNDIThreadPool::Clock::time_point CinderNDIReceiver::capture( bool mayBlock )
+{
+	NDIlib_video_frame_v2_t video_frame;
+	NDIlib_audio_frame_v2_t audio_frame;
+	NDIlib_metadata_frame_t metadata_frame;
+
+	// frames are copied and handed back to NDI right away, so NDI never runs out of buffers while update()
+	// is busy, and a reconnect never invalidates a frame update() is still reading.
+	// only the first capture waits, the rest take what is already there.
+	for( int i = 0; i < kMaxFramesPerCapture; ++i ) {
+		const uint32_t timeout = mayBlock && i == 0 ? kCaptureTimeoutMs : 0;
+		switch( NDIlib_recv_capture_v2( mNdiReceiver, &video_frame, mCaptureAudio ? &audio_frame : NULL, &metadata_frame, timeout ) ) {
+			case NDIlib_frame_type_video:
+			{
+				CapturedVideoFrame& frame = mCapturedFrames.getWriteBuffer();
+				const size_t colorBytes = (size_t)video_frame.line_stride_in_bytes * video_frame.yres;
+				frame.videoFrame = video_frame;
+				frame.data.resize( video_frame.FourCC == NDIlib_FourCC_type_UYVA ? colorBytes + colorBytes / 2 : colorBytes );
+				std::memcpy( frame.data.data(), video_frame.p_data, frame.data.size() );
+				frame.metadata.assign( video_frame.p_metadata ? video_frame.p_metadata : "" );
+				NDIlib_recv_free_video_v2( mNdiReceiver, &video_frame );
+				mCapturedFrames.publish();
+				break;
+			}
+
+			case NDIlib_frame_type_audio:
+			{
+				CapturedAudioFrame& frame = mCaptureAudioFrame;
+				frame.audioFrame = audio_frame;
+				frame.data.resize( (size_t)audio_frame.channel_stride_in_bytes * audio_frame.no_channels / sizeof( float ) );
+				std::memcpy( frame.data.data(), audio_frame.p_data, frame.data.size() * sizeof( float ) );
+				frame.metadata.assign( audio_frame.p_metadata ? audio_frame.p_metadata : "" );
+				NDIlib_recv_free_audio_v2( mNdiReceiver, &audio_frame );
+				// dropped when update() fell that far behind.
+				mCapturedAudio.pushSwap( frame );
+				break;
+			}
+
+			case NDIlib_frame_type_metadata:
+			{
+				CapturedMetadataFrame frame;
+				frame.data.assign( metadata_frame.p_data ? metadata_frame.p_data : "" );
+				frame.timecode = metadata_frame.timecode;
+				NDIlib_recv_free_metadata( mNdiReceiver, &metadata_frame );
+				mCapturedMetadata.push( std::move( frame ) );
+				break;
+			}
+
+			case NDIlib_frame_type_none:
+				return mayBlock ? CinderNDIThreadPool::Clock::now() : CinderNDIThreadPool::Clock::now() + kCapturePollInterval;
+
+			default:
+				break;
 		}
+	}
+	return CinderNDIThreadPool::Clock::now();
+}
 
-		// Meta data
-		case NDIlib_frame_type_metadata:
-		{
-			//CI_LOG_I( "Meta data received." );
-			mMetadata.first = metadata_frame.p_data;
-			mMetadata.second = metadata_frame.timecode;
-			NDIlib_recv_free_metadata( mNdiReceiver, &metadata_frame );
-			break;
+void CinderNDIReceiver::receiveCapturedFrames()
+{
+	// the copies moved through the queues, so the pointers into them are set here.
+	while( mCapturedAudio.pop( mReceiveAudioFrame ) ) {
+		if( mAudioFrameCallback ) {
+			NDIlib_audio_frame_v2_t& audioFrame = mReceiveAudioFrame.audioFrame;
+			audioFrame.p_data = mReceiveAudioFrame.data.data();
+			audioFrame.p_metadata = mReceiveAudioFrame.metadata.empty() ? NULL : mReceiveAudioFrame.metadata.c_str();
+			mAudioFrameCallback( audioFrame );
 		}
+	}
+
+	CapturedMetadataFrame metadata;
+	while( mCapturedMetadata.pop( metadata ) ) {
+		NDIlib_metadata_frame_t metadataFrame;
+		metadataFrame.length = (int)metadata.data.size() + 1;
+		metadataFrame.timecode = metadata.timecode;
+		metadataFrame.p_data = const_cast<char*>( metadata.data.c_str() );
+		handleMetadataFrame( metadataFrame );
+	}
+
+	if( mCapturedFrames.update() ) {
+		CapturedVideoFrame& frame = mCapturedFrames.getReadBuffer();
+		frame.videoFrame.p_data = frame.data.data();
+		frame.videoFrame.p_metadata = frame.metadata.empty() ? NULL : frame.metadata.c_str();
+		handleVideoFrame( frame.videoFrame );
+	}
+}
+
+void CinderNDIReceiver::setUsage( Usage usage )
+{
+	if( usage == mUsage ) {
+		return;
+	}
+	if( usage == Usage::Hidden ) {
+		mHiddenSince = std::chrono::steady_clock::now();
+	}
+	mUsage = usage;
+	sendTally();
+}
+
+void CinderNDIReceiver::updateBandwidth()
+{
+	const NDIlib_recv_bandwidth_e bandwidth = mUsage == Usage::Hidden ? mHiddenBandwidth : NDIlib_recv_bandwidth_highest;
+	CinderNDIDiscovery::Source source;
+	{
+		std::lock_guard<std::mutex> lock( mSourcesMutex );
+		source = mCurrentSource;
+	}
+	if( bandwidth == mBandwidth || mConnecting || source.name.empty() ) {
+		return;
+	}
+	if( mUsage == Usage::Hidden && std::chrono::duration<double>( std::chrono::steady_clock::now() - mHiddenSince ).count() < mHiddenDelay ) {
+		return;
+	}
+
+	// NDI receivers pick their bandwidth when created, so changing it means reconnecting.
+	if( mVerbose ) CI_LOG_I( "Reconnecting NDI source '" << source.name << "' at " << ( bandwidth == NDIlib_recv_bandwidth_highest ? "full" : "reduced" ) << " bandwidth" );
+	mBandwidth = bandwidth;
+	connect( source );
+}
+
+void CinderNDIReceiver::setUploadScheduler( const std::shared_ptr<CinderNDIUploadScheduler>& scheduler )
+{
+	if( mUploadScheduler ) {
+		mUploadScheduler->removeReceiver( this );
+	}
+	mUploadScheduler = scheduler;
+	if( mUploadScheduler ) {
+		mUploadScheduler->addReceiver( this );
+	}
+}
 
+CinderNDIUploadScheduler::Priority CinderNDIReceiver::getUploadPriority() const
+{
+	switch( mUsage ) {
+		case Usage::Program:
+			return CinderNDIUploadScheduler::Priority::Program;
+		case Usage::Preview:
+			return CinderNDIUploadScheduler::Priority::Preview;
 		default:
-			break;
+			return CinderNDIUploadScheduler::Priority::Background;
+	}
+}
+
+void CinderNDIReceiver::sendTally()
+{
+	if( ! mNdiReceiver ) {
+		return;
+	}
+	NDIlib_tally_t tally_state;
+	tally_state.on_program = mUsage == Usage::Program;
+	tally_state.on_preview = mUsage == Usage::Preview;
+	NDIlib_recv_set_tally( mNdiReceiver, &tally_state );
+}
+
+void CinderNDIReceiver::scheduleVideoFrame( const NDIlib_video_frame_v2_t& videoFrame )
+{
+	// a deferred frame is older than this one, so this one replaces it rather than overtaking it.
+	if( mHasDeferredFrame ) {
+		if( mUploadScheduler ) {
+			mUploadScheduler->countReplaced( getUploadPriority() );
+		}
+		deferVideoFrame( videoFrame );
+		return;
+	}
+	auto decision = CinderNDIUploadScheduler::Decision::Upload;
+	if( mUploadScheduler ) {
+		decision = mUploadScheduler->schedule( (size_t)videoFrame.xres * videoFrame.yres * 4, getUploadPriority() );
+	}
+	if( decision == CinderNDIUploadScheduler::Decision::Upload ) {
+		uploadVideoFrame( videoFrame );
+	}
+	else if( decision == CinderNDIUploadScheduler::Decision::Defer ) {
+		deferVideoFrame( videoFrame );
+	}
+}
+
+void CinderNDIReceiver::deferVideoFrame( const NDIlib_video_frame_v2_t& videoFrame )
+{
+	// NDI gets the frame back at the end of update(), so the pixels are copied.
+	const int stride = videoFrame.line_stride_in_bytes;
+	mDeferredData.resize( (size_t)stride * videoFrame.yres );
+	std::memcpy( mDeferredData.data(), videoFrame.p_data, mDeferredData.size() );
+	mDeferredFrame = videoFrame;
+	mDeferredFrame.p_data = mDeferredData.data();
+	mDeferredFrame.p_metadata = nullptr;
+	mHasDeferredFrame = true;
+}
+
+void CinderNDIReceiver::uploadVideoFrame( const NDIlib_video_frame_v2_t& videoFrame )
+{
+	if( videoFrame.frame_format_type == NDIlib_frame_format_type_field_0 || videoFrame.frame_format_type == NDIlib_frame_format_type_field_1 ) {
+		const int field = videoFrame.frame_format_type == NDIlib_frame_format_type_field_0 ? 0 : 1;
+		mDeinterlacer.addField( videoFrame.p_data, videoFrame.line_stride_in_bytes, videoFrame.xres, videoFrame.yres, field );
+		auto texture = mDeinterlacer.render( field );
+		if( texture ) {
+			mVideoTexture.first = texture;
+			mVideoTexture.second = videoFrame.timecode;
+		}
+	}
+	else if( videoFrame.frame_format_type == NDIlib_frame_format_type_interleaved && mDeinterlacer.getMode() != CinderNDIDeinterlacer::Mode::Weave ) {
+		// field 0 is the earlier one, field 1 follows half a frame later.
+		mDeinterlacer.addInterleavedFrame( videoFrame.p_data, videoFrame.line_stride_in_bytes, videoFrame.xres, videoFrame.yres );
+		auto texture = mDeinterlacer.render( 0 );
+		if( texture ) {
+			mVideoTexture.first = texture;
+			mVideoTexture.second = videoFrame.timecode;
+			mPendingField = 1;
+			mPendingFieldTimecode = videoFrame.frame_rate_N > 0 ? videoFrame.timecode + ( 10000000LL * videoFrame.frame_rate_D ) / ( 2LL * videoFrame.frame_rate_N ) : videoFrame.timecode;
+		}
+	}
+	else {
+		// progressive frames, and interleaved ones in weave mode, are already complete.
+		auto surface = ci::Surface::create( videoFrame.p_data, videoFrame.xres, videoFrame.yres, videoFrame.line_stride_in_bytes, ci::SurfaceChannelOrder::BGRA );
+		mVideoTexture.first = ci::gl::Texture::create( *surface );
+		mVideoTexture.first->setTopDown( false );
+		mVideoTexture.second = videoFrame.timecode;
+		mDeinterlacer.reset();
+	}
+	if( mInterlaced && mVideoTexture.first ) {
+		mVideoTexture.first->setTopDown( false );
+	}
+
+	if( mAlphaTextureEnabled && mHasAlpha ) {
+		if( mAlphaChannel.getWidth() != videoFrame.xres || mAlphaChannel.getHeight() != videoFrame.yres ) {
+			mAlphaChannel = ci::Channel8u( videoFrame.xres, videoFrame.yres );
+		}
+		CinderNDIConvert::extractAlpha( videoFrame.p_data, videoFrame.line_stride_in_bytes, videoFrame.xres, videoFrame.yres, mAlphaChannel.getData(), mAlphaChannel.getRowBytes() );
+		if( mAlphaTexture && mAlphaTexture->getWidth() == videoFrame.xres && mAlphaTexture->getHeight() == videoFrame.yres ) {
+			mAlphaTexture->update( mAlphaChannel );
+		}
+		else {
+			mAlphaTexture = ci::gl::Texture::create( mAlphaChannel );
+			mAlphaTexture->setTopDown( false );
+		}
+	}
+	else {
+		mAlphaTexture.reset();
+	}
+}
+
+bool CinderNDIReceiver::isPrimarySource( const CinderNDIDiscovery::Source& source ) const
+{
+	return ! mPrimarySenderName.empty() && CinderNDISourceMatcher::matches( mPrimaryMatchMode, mPrimarySenderName, source );
+}
+
+bool CinderNDIReceiver::findSource( const std::string& pattern, CinderNDISourceMatcher::Mode mode, CinderNDIDiscovery::Source& source ) const
+{
+	return mDiscovery && mDiscovery->getMatcher()->find( mode, pattern, source ) == CinderNDISourceMatcher::Result::Found;
+}
+
+void CinderNDIReceiver::setReconnectBackoff( double initialSeconds, double maxSeconds )
+{
+	mReconnectBackoff = initialSeconds;
+	mMaxReconnectBackoff = std::max( initialSeconds, maxSeconds );
+}
+
+void CinderNDIReceiver::setBackupSource( const std::string& name, int failoverAttempts, CinderNDISourceMatcher::Mode matchMode )
+{
+	mBackupSenderName = name;
+	mBackupMatchMode = matchMode;
+	mFailoverAttempts = std::max( 0, failoverAttempts );
+}
+
+std::vector<CinderNDIReceiver::StateChange> CinderNDIReceiver::getStateHistory()
+{
+	std::lock_guard<std::mutex> lock( mStateHistoryMutex );
+	return std::vector<StateChange>( mStateHistory.begin(), mStateHistory.end() );
+}
+
+void CinderNDIReceiver::setState( State state, const std::string& reason )
+{
+	if( state == mState ) {
+		return;
+	}
+	mState = state;
+
+	StateChange change;
+	change.state = state;
+	change.time = std::chrono::system_clock::now();
+	change.sourceName = getCurrentSenderName();
+	change.reason = reason;
+	{
+		std::lock_guard<std::mutex> lock( mStateHistoryMutex );
+		mStateHistory.push_back( change );
+		while( mStateHistory.size() > 64 ) {
+			mStateHistory.pop_front();
+		}
+	}
+
+	static const char* kStateNames[] = { "searching", "connected", "stalled", "reconnecting", "failed over" };
+	if( state == State::Stalled || state == State::FailedOver ) {
+		CI_LOG_W( "NDI source '" << change.sourceName << "' " << kStateNames[(int)state] << ": " << reason );
+	}
+	else {
+		CI_LOG_I( "NDI source '" << change.sourceName << "' " << kStateNames[(int)state] << ": " << reason );
+	}
+	if( mStateCallback ) {
+		mStateCallback( change );
+	}
+}
+
+void CinderNDIReceiver::updateWatchdog()
+{
+	connectPendingSource();
+
+	const auto now = std::chrono::steady_clock::now();
+	if( mPrimaryReturned.exchange( false ) && ! mConnecting ) {
+		std::string primary;
+		CinderNDISourceMatcher::Mode primaryMode;
+		{
+			std::lock_guard<std::mutex> lock( mSourcesMutex );
+			primary = mPrimarySenderName;
+			primaryMode = mPrimaryMatchMode;
+		}
+		CinderNDIDiscovery::Source source;
+		if( ! primary.empty() && findSource( primary, primaryMode, source ) ) {
+			connect( source );
+			// counts as the first attempt, the backoff starts over should the source fail again.
+			mReconnectAttempts = 1;
+			mNextReconnectTime = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( mReconnectBackoff ) );
+			setState( State::Reconnecting, "preferred source is back" );
+			return;
+		}
+	}
+
+	const State state = mState;
+
+	if( state == State::Connected || state == State::FailedOver ) {
+		// metadata only connections carry no video to time out on.
+		const bool watchVideo = mStallTimeout > 0.0 && mBandwidth != NDIlib_recv_bandwidth_metadata_only;
+		if( mSourceLost.exchange( false ) ) {
+			setState( State::Stalled, "source left the network" );
+		}
+		else if( watchVideo && std::chrono::duration<double>( now - mLastVideoTime ).count() > mStallTimeout ) {
+			setState( State::Stalled, "no video for " + std::to_string( mStallTimeout ) + " s" );
+		}
+		else {
+			return;
+		}
+		mReconnectAttempts = 0;
+		mNextReconnectTime = now;
+	}
+
+	const State current = mState;
+	if( ( current != State::Stalled && current != State::Reconnecting ) || mConnecting || now < mNextReconnectTime ) {
+		return;
+	}
+
+	++mReconnectAttempts;
+	const double backoff = std::min( mMaxReconnectBackoff, mReconnectBackoff * std::pow( 2.0, std::min( mReconnectAttempts - 1, 16 ) ) );
+	mNextReconnectTime = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( backoff ) );
+
+	std::string primary;
+	CinderNDISourceMatcher::Mode primaryMode;
+	{
+		std::lock_guard<std::mutex> lock( mSourcesMutex );
+		primary = mPrimarySenderName;
+		primaryMode = mPrimaryMatchMode;
+	}
+
+	CinderNDIDiscovery::Source source;
+	if( ! mBackupSenderName.empty() && mReconnectAttempts > mFailoverAttempts && findSource( mBackupSenderName, mBackupMatchMode, source ) ) {
+		CI_LOG_W( "Failing over to backup NDI source '" << source.name << "'" );
+		connect( source, true );
+		setState( State::Reconnecting, "failing over to '" + source.name + "'" );
+	}
+	else if( ! primary.empty() && findSource( primary, primaryMode, source ) ) {
+		CI_LOG_I( "Reconnecting to NDI source '" << source.name << "', attempt " << mReconnectAttempts );
+		connect( source );
+		setState( State::Reconnecting, "attempt " + std::to_string( mReconnectAttempts ) );
+	}
+	else {
+		setState( State::Reconnecting, "waiting for the source to return" );
 	}
 }
 
@@ -244,7 +849,8 @@ int CinderNDIReceiver::getCurrentSenderIndex() {
 }
 
 int CinderNDIReceiver::getNumberOfSendersFound() {
-	return mNDIsenderNames.size();
+	std::lock_guard<std::mutex> lock( mSourcesMutex );
+	return (int)mSources.size();
 }
 
 void CinderNDIReceiver::switchSource(int index) {
@@ -252,14 +858,49 @@ void CinderNDIReceiver::switchSource(int index) {
 }
 
 std::string CinderNDIReceiver::getCurrentSenderName() {
-	if (mNDIsenderNames.size() == 0) {
+	std::lock_guard<std::mutex> lock( mSourcesMutex );
+	if (mCurrentSource.name.empty()) {
 		return "none";
 	} else {
-		return mNDIsenderNames[mCurrentIndex];
+		return mCurrentSource.name;
 	}
 }
 
 
+bool CinderNDIReceiver::startRecording( const std::string& path )
+{
+	stopRecording();
+
+	if( mReady && NDIlib_recv_recording_is_supported( mNdiReceiver ) ) {
+		if( NDIlib_recv_recording_start( mNdiReceiver, path.c_str() ) ) {
+			CI_LOG_I( "Recording NDI source '" << getCurrentSenderName() << "' at the source" );
+			mRemoteRecording = true;
+			return true;
+		}
+		CI_LOG_W( "NDI source '" << getCurrentSenderName() << "' refused to record, recording received frames instead" );
+	}
+	return mRecorder.start( path );
+}
+
+void CinderNDIReceiver::stopRecording()
+{
+	if( mRemoteRecording ) {
+		if( mReady ) {
+			NDIlib_recv_recording_stop( mNdiReceiver );
+		}
+		mRemoteRecording = false;
+	}
+	mRecorder.stop();
+}
+
+bool CinderNDIReceiver::isRecording()
+{
+	if( mRemoteRecording ) {
+		return mReady && NDIlib_recv_recording_is_recording( mNdiReceiver );
+	}
+	return mRecorder.isRecording();
+}
+
 std::pair<std::string, long long> CinderNDIReceiver::getMetadata()
 {
 	return mMetadata;
@@ -0,0 +1,196 @@
+#include "CinderNDIRecorder.h"
+
+#include <cstring>
+
+#include "cinder/Log.h"
+
+#include "CinderNDISender.h"
+
+namespace {
+
+// More than the memory bound allows for any real frame size, the bytes are what limits the queue.
+const size_t kMaxQueuedFrames = 1024;
+// How long the write job waits on its blocking lane for new frames, and how often it looks for them when
+// every lane was taken and it runs on the workers instead.
+const std::chrono::milliseconds kWriteWaitTimeout( 100 );
+const std::chrono::milliseconds kWritePollInterval( 5 );
+// Frames written before the step returns, so stop() and other jobs never wait behind a long backlog.
+const size_t kMaxFramesPerWrite = 8;
+
+} // anonymous namespace
+
+CinderNDIRecorder::CinderNDIRecorder( size_t maxBufferedBytes )
+	: mMaxBufferedBytes{ maxBufferedBytes }, mQueue{ kMaxQueuedFrames }, mFreeFrames{ kMaxQueuedFrames }, mStopping{ false }, mWriteFailed{ false }
+{
+	mNumBytesBuffered = 0;
+	mRecording = false;
+	mNumFramesWritten = 0;
+	mNumFramesDropped = 0;
+	mNumBytesWritten = 0;
+}
+
+CinderNDIRecorder::~CinderNDIRecorder()
+{
+	stop();
+}
+
+size_t CinderNDIRecorder::calcFrameSize( const NDIlib_video_frame_v2_t& videoFrame )
+{
+	const size_t rowBytes = CinderNDISender::calcLineStride( videoFrame.xres, videoFrame.FourCC );
+	const size_t colorBytes = rowBytes * videoFrame.yres;
+	return videoFrame.FourCC == NDIlib_FourCC_type_UYVA ? colorBytes + colorBytes / 2 : colorBytes;
+}
+
+bool CinderNDIRecorder::start( const std::string& path )
+{
+	stop();
+
+	if( ! mWriter.open( path ) ) {
+		return false;
+	}
+
+	mPath = path;
+	mNumFramesWritten = 0;
+	mNumFramesDropped = 0;
+	mNumBytesWritten = 0;
+	mStartTime = std::chrono::steady_clock::now();
+	mWriteFailed = false;
+	mStopping = false;
+	mRecording = true;
+	if( ! mThreadPool ) {
+		mThreadPool = CinderNDIThreadPool::getDefault();
+	}
+	// disk writes block, so they get a blocking lane rather than a worker that may be pacing video.
+	mWriteJob = mThreadPool->startBlockingJob( "NDI recorder " + path, [this]( bool mayBlock ) { return write( mayBlock ); } );
+	return true;
+}
+
+void CinderNDIRecorder::stop()
+{
+	if( ! mWriteJob ) {
+		return;
+	}
+
+	mRecording = false;
+	{
+		std::lock_guard<std::mutex> lock( mWriteMutex );
+		mStopping = true;
+	}
+	mWriteCondition.notify_one();
+	mThreadPool->stopJob( mWriteJob );
+	mWriteJob.reset();
+	// everything queued before stop() goes to disk before the file is closed.
+	while( writeQueuedFrame() ) {
+	}
+	mWriter.close();
+	mNumBytesWritten = mWriter.getNumBytesWritten();
+}
+
+bool CinderNDIRecorder::addFrame( const NDIlib_video_frame_v2_t& videoFrame )
+{
+	if( ! mRecording ) {
+		return false;
+	}
+
+	const size_t size = calcFrameSize( videoFrame );
+	if( ! size ) {
+		// unsupported formats can't be written, but they still count against the recording.
+		++mNumFramesDropped;
+		return false;
+	}
+	if( mNumBytesBuffered + size > mMaxBufferedBytes ) {
+		++mNumFramesDropped;
+		return false;
+	}
+
+	std::unique_ptr<Frame> frame;
+	if( ! mFreeFrames.pop( frame ) || ! frame ) {
+		frame.reset( new Frame );
+	}
+
+	// packing the rows so the file doesn't depend on the sender's padding.
+	const int rowBytes = CinderNDISender::calcLineStride( videoFrame.xres, videoFrame.FourCC );
+	const int stride = videoFrame.line_stride_in_bytes ? videoFrame.line_stride_in_bytes : rowBytes;
+	frame->data.resize( size );
+	for( int y = 0; y < videoFrame.yres; ++y ) {
+		std::memcpy( frame->data.data() + (size_t)y * rowBytes, videoFrame.p_data + (ptrdiff_t)y * stride, rowBytes );
+	}
+	if( videoFrame.FourCC == NDIlib_FourCC_type_UYVA ) {
+		const uint8_t* srcAlpha = videoFrame.p_data + (ptrdiff_t)videoFrame.yres * stride;
+		uint8_t* dstAlpha = frame->data.data() + (size_t)rowBytes * videoFrame.yres;
+		for( int y = 0; y < videoFrame.yres; ++y ) {
+			std::memcpy( dstAlpha + (size_t)y * rowBytes / 2, srcAlpha + (ptrdiff_t)y * stride / 2, rowBytes / 2 );
+		}
+	}
+
+	CinderNDIFrameFile::IndexEntry& entry = frame->entry;
+	entry.size = size;
+	entry.timecode = videoFrame.timecode;
+	entry.fourCC = videoFrame.FourCC;
+	entry.xres = videoFrame.xres;
+	entry.yres = videoFrame.yres;
+	entry.lineStride = rowBytes;
+	entry.frameRateN = videoFrame.frame_rate_N;
+	entry.frameRateD = videoFrame.frame_rate_D;
+	entry.pictureAspectRatio = videoFrame.picture_aspect_ratio;
+	entry.frameFormatType = videoFrame.frame_format_type;
+	frame->metadata.assign( videoFrame.p_metadata ? videoFrame.p_metadata : "" );
+
+	if( ! mQueue.push( std::move( frame ) ) ) {
+		++mNumFramesDropped;
+		return false;
+	}
+	mNumBytesBuffered += size;
+	{
+		std::lock_guard<std::mutex> lock( mWriteMutex );
+	}
+	mWriteCondition.notify_one();
+	return true;
+}
+
+double CinderNDIRecorder::getBytesPerSecond() const
+{
+	double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - mStartTime ).count();
+	return seconds > 0.0 ? mNumBytesWritten / seconds : 0.0;
+}
+
+CinderNDIThreadPool::Clock::time_point CinderNDIRecorder::write( bool mayBlock )
+{
+	if( mayBlock ) {
+		std::unique_lock<std::mutex> lock( mWriteMutex );
+		mWriteCondition.wait_for( lock, kWriteWaitTimeout, [this] { return ! mQueue.empty() || mStopping; } );
+	}
+	for( size_t i = 0; i < kMaxFramesPerWrite; ++i ) {
+		if( ! writeQueuedFrame() ) {
+			return mayBlock ? CinderNDIThreadPool::Clock::now() : CinderNDIThreadPool::Clock::now() + kWritePollInterval;
+		}
+	}
+	// more may be waiting, run again once the other ready jobs had their turn.
+	return CinderNDIThreadPool::Clock::now();
+}
+
+bool CinderNDIRecorder::writeQueuedFrame()
+{
+	std::unique_ptr<Frame> frame;
+	if( ! mQueue.pop( frame ) ) {
+		return false;
+	}
+
+	// after a failed write the rest of the queue is dropped, the file may be missing frames but stays readable.
+	if( ! mWriteFailed && ! mWriter.addFrame( frame->entry, frame->data.data(), frame->metadata.c_str() ) ) {
+		CI_LOG_E( "Failed to write NDI recording '" << mPath << "', recording stopped" );
+		mWriteFailed = true;
+		mRecording = false;
+	}
+	mNumBytesBuffered -= frame->data.size();
+	if( mWriteFailed ) {
+		++mNumFramesDropped;
+	}
+	else {
+		mNumBytesWritten = mWriter.getNumBytesWritten();
+		++mNumFramesWritten;
+	}
+
+	mFreeFrames.push( std::move( frame ) );
+	return true;
+}
@@ -0,0 +1,118 @@
+#include "CinderNDIRelay.h"
+
+#include "cinder/gl/scoped.h"
+
+CinderNDIRelay::CinderNDIRelay( const std::string& outputName )
+	: mSender{ outputName, false }, mHasGpuFrame{ false }, mGpuFrameTimecode{ 0 }, mHasPendingReadback{ false }, mPendingReadbackTimecode{ 0 },
+	mNumForwardedFrames{ 0 }
+{
+	// without a GPU stage nothing needs textures.
+	mReceiver.setTextureUploadEnabled( false );
+	mReceiver.setVideoFrameCallback( [this]( const NDIlib_video_frame_v2_t& videoFrame ) {
+		onVideoFrame( videoFrame );
+	} );
+	mReceiver.setAudioFrameCallback( [this]( const NDIlib_audio_frame_v2_t& audioFrame ) {
+		mSender.sendAudioFrame( audioFrame );
+	} );
+	mReceiver.setMetadataFrameCallback( [this]( const NDIlib_metadata_frame_t& metadataFrame ) {
+		mSender.sendMetadataFrame( metadataFrame );
+	} );
+}
+
+void CinderNDIRelay::setup( const std::string& sourceName, CinderNDISourceMatcher::Mode matchMode )
+{
+	mReceiver.setup( sourceName, matchMode );
+}
+
+void CinderNDIRelay::setCpuStage( const CpuStage& stage )
+{
+	mCpuStage = stage;
+	mGpuStage = nullptr;
+	mReceiver.setTextureUploadEnabled( false );
+}
+
+void CinderNDIRelay::setGpuStage( const GpuStage& stage )
+{
+	mGpuStage = stage;
+	mCpuStage = nullptr;
+	mReceiver.setTextureUploadEnabled( (bool)mGpuStage );
+	mHasPendingReadback = false;
+}
+
+void CinderNDIRelay::update()
+{
+	mReceiver.update();
+	if( mGpuStage ) {
+		processGpuFrame();
+	}
+}
+
+void CinderNDIRelay::onVideoFrame( const NDIlib_video_frame_v2_t& videoFrame )
+{
+	if( videoFrame.frame_rate_N != mSender.getFramerateNumerator() || videoFrame.frame_rate_D != mSender.getFramerateDenominator() ) {
+		mSender.setFramerate( videoFrame.frame_rate_N, videoFrame.frame_rate_D );
+	}
+
+	// the receiver uploaded the frame before calling back, the GPU stage draws it after update().
+	if( mGpuStage ) {
+		mHasGpuFrame = true;
+		mGpuFrameTimecode = videoFrame.timecode;
+		return;
+	}
+
+	if( ! mSender.shouldSendFrame() ) {
+		return;
+	}
+
+	// the receiver frees the frame when this returns, so it is sent synchronously: NDI is done with the
+	// buffer by then and the frame needs no copy that outlives the callback. The source clocks the stream,
+	// so the sender doesn't and the send never waits for a frame period.
+	NDIlib_video_frame_v2_t frame = videoFrame;
+	if( mCpuStage ) {
+		mCpuStage( frame );
+	}
+	if( mSender.sendVideoFrame( frame ) ) {
+		++mNumForwardedFrames;
+	}
+}
+
+void CinderNDIRelay::processGpuFrame()
+{
+	if( ! mHasGpuFrame ) {
+		return;
+	}
+	mHasGpuFrame = false;
+
+	auto texture = mReceiver.getVideoTexture().first;
+	if( ! texture ) {
+		return;
+	}
+	if( ! mSender.shouldSendFrame() ) {
+		mHasPendingReadback = false;
+		return;
+	}
+
+	if( ! mFbo || mFbo->getSize() != texture->getSize() ) {
+		mFbo = ci::gl::Fbo::create( texture->getWidth(), texture->getHeight() );
+		mReadback.reset( new CinderNDIReadback( texture->getWidth(), texture->getHeight() ) );
+		mHasPendingReadback = false;
+	}
+
+	{
+		ci::gl::ScopedFramebuffer scopedFramebuffer( mFbo );
+		ci::gl::ScopedViewport scopedViewport( ci::ivec2( 0 ), mFbo->getSize() );
+		ci::gl::ScopedMatrices scopedMatrices;
+		ci::gl::setMatricesWindow( mFbo->getSize() );
+		mGpuStage( texture );
+	}
+
+	// the stage may draw anywhere, and the surface patched now holds the frame drawn by the previous update().
+	mReadback->markAllDirty();
+	if( mReadback->readback( mFbo ) && mHasPendingReadback ) {
+		auto surface = mReadback->getSurface();
+		mSender.sendSurface( *surface, surface->getBounds(), mPendingReadbackTimecode, true );
+		++mNumForwardedFrames;
+	}
+	mHasPendingReadback = true;
+	mPendingReadbackTimecode = mGpuFrameTimecode;
+}
@@ -0,0 +1,242 @@
+#include "CinderNDIRouter.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "cinder/Log.h"
+
+#include <Processing.NDI.Routing.h>
+
+CinderNDIRouter::CinderNDIRouter( const std::string& groups )
+	: mGroups{ groups }, mLocalMachine{ CinderNDISourceMatcher::getLocalMachine() }, mDiscoveryListener{ 0 }
+{
+	if( ! NDIlib_initialize() ) {
+		CI_LOG_E( "Failed to initialize NDI!" );
+	}
+}
+
+CinderNDIRouter::~CinderNDIRouter()
+{
+	// no events may arrive while the routes go away.
+	if( mDiscovery ) {
+		mDiscovery->removeListener( mDiscoveryListener );
+	}
+	for( auto& route : mRoutes ) {
+		NDIlib_routing_destroy( route.second.instance );
+	}
+	mRoutes.clear();
+	NDIlib_destroy();
+}
+
+void CinderNDIRouter::setDiscovery( const std::shared_ptr<CinderNDIDiscovery>& discovery )
+{
+	if( discovery == mDiscovery ) {
+		return;
+	}
+	if( mDiscovery ) {
+		mDiscovery->removeListener( mDiscoveryListener );
+		mDiscovery.reset();
+	}
+	if( discovery ) {
+		mDiscovery = discovery;
+		// the replay re-resolves every route against the new list.
+		mDiscoveryListener = mDiscovery->addListener( [this]( CinderNDIDiscovery::Event event, const CinderNDIDiscovery::Source& source ) {
+			onSourceEvent( event, source );
+		} );
+	}
+}
+
+void CinderNDIRouter::listen()
+{
+	// not under mRoutesMutex, the discovery holds its listener lock while it calls onSourceEvent().
+	if( ! mDiscovery ) {
+		setDiscovery( CinderNDIDiscovery::getDefault() );
+	}
+}
+
+CinderNDIRouter::Route* CinderNDIRouter::createRoute( const std::string& name )
+{
+	auto it = mRoutes.find( name );
+	if( it != mRoutes.end() ) {
+		return &it->second;
+	}
+
+	NDIlib_routing_create_t NDI_routing_create_desc;
+	NDI_routing_create_desc.p_ndi_name = name.c_str();
+	NDI_routing_create_desc.p_groups = mGroups.empty() ? NULL : mGroups.c_str();
+	NDIlib_routing_instance_t instance = NDIlib_routing_create( &NDI_routing_create_desc );
+	if( ! instance ) {
+		CI_LOG_E( "Failed to create NDI route '" << name << "'" );
+		return nullptr;
+	}
+
+	Route& route = mRoutes[name];
+	route.instance = instance;
+	route.matchMode = CinderNDISourceMatcher::Mode::Exact;
+	return &route;
+}
+
+bool CinderNDIRouter::route( const std::string& name, const std::string& pattern, CinderNDISourceMatcher::Mode matchMode )
+{
+	listen();
+
+	std::lock_guard<std::mutex> lock( mRoutesMutex );
+	Route* route = createRoute( name );
+	if( ! route ) {
+		return false;
+	}
+	route->pattern = pattern;
+	route->matchMode = matchMode;
+	resolve( name, *route );
+	return true;
+}
+
+bool CinderNDIRouter::route( const std::string& name, const CinderNDIDiscovery::Source& source )
+{
+	listen();
+
+	std::lock_guard<std::mutex> lock( mRoutesMutex );
+	if( isOwnRoute( source ) ) {
+		CI_LOG_W( "Not routing '" << name << "' to the route '" << source.name << "'" );
+		return false;
+	}
+	Route* route = createRoute( name );
+	if( ! route ) {
+		return false;
+	}
+	route->pattern.clear();
+	change( name, *route, source );
+	return true;
+}
+
+void CinderNDIRouter::clear( const std::string& name )
+{
+	std::lock_guard<std::mutex> lock( mRoutesMutex );
+	auto it = mRoutes.find( name );
+	if( it != mRoutes.end() ) {
+		it->second.pattern.clear();
+		change( name, it->second, CinderNDIDiscovery::Source() );
+	}
+}
+
+void CinderNDIRouter::remove( const std::string& name )
+{
+	std::lock_guard<std::mutex> lock( mRoutesMutex );
+	auto it = mRoutes.find( name );
+	if( it != mRoutes.end() ) {
+		NDIlib_routing_destroy( it->second.instance );
+		mRoutes.erase( it );
+	}
+}
+
+bool CinderNDIRouter::hasRoute( const std::string& name ) const
+{
+	std::lock_guard<std::mutex> lock( mRoutesMutex );
+	return mRoutes.count( name ) > 0;
+}
+
+std::string CinderNDIRouter::getRoutedSourceName( const std::string& name ) const
+{
+	std::lock_guard<std::mutex> lock( mRoutesMutex );
+	auto it = mRoutes.find( name );
+	return it != mRoutes.end() ? it->second.source.name : "";
+}
+
+std::vector<std::string> CinderNDIRouter::getRouteNames() const
+{
+	std::lock_guard<std::mutex> lock( mRoutesMutex );
+	std::vector<std::string> names;
+	for( const auto& route : mRoutes ) {
+		names.push_back( route.first );
+	}
+	return names;
+}
+
+bool CinderNDIRouter::isOwnRoute( const CinderNDIDiscovery::Source& source ) const
+{
+	// routes show up in the discovery like any other source on this machine. Pointing one at itself or at
+	// another route would loop, so sources of this machine named like a route are never routed to. Sources
+	// of the same name on other machines are fine, that is how a source gets re-exposed under its own name.
+	std::string machine, stream;
+	if( ! CinderNDISourceMatcher::splitName( source.name, machine, stream ) || ! mRoutes.count( stream ) ) {
+		return false;
+	}
+	std::transform( machine.begin(), machine.end(), machine.begin(), []( char c ) { return (char)std::tolower( (unsigned char)c ); } );
+	// without a known machine name every source named like a route is treated as one, rather than risk a loop.
+	return mLocalMachine.empty() || machine == mLocalMachine;
+}
+
+bool CinderNDIRouter::findSource( const Route& route, CinderNDIDiscovery::Source& source ) const
+{
+	if( ! mDiscovery ) {
+		return false;
+	}
+	auto sources = mDiscovery->getMatcher()->findAll( route.matchMode, route.pattern );
+	sources.erase( std::remove_if( sources.begin(), sources.end(), [this]( const CinderNDIDiscovery::Source& candidate ) {
+		return isOwnRoute( candidate );
+	} ), sources.end() );
+	if( sources.size() > 1 ) {
+		CI_LOG_W( "NDI source name '" << route.pattern << "' is ambiguous, it matches " << sources.size() << " sources" );
+	}
+	if( sources.size() != 1 ) {
+		return false;
+	}
+	source = sources[0];
+	return true;
+}
+
+void CinderNDIRouter::resolve( const std::string& name, Route& route )
+{
+	CinderNDIDiscovery::Source source;
+	if( ! findSource( route, source ) ) {
+		source = CinderNDIDiscovery::Source();
+	}
+	change( name, route, source );
+}
+
+void CinderNDIRouter::change( const std::string& name, Route& route, const CinderNDIDiscovery::Source& source )
+{
+	if( source.name == route.source.name && source.url == route.source.url ) {
+		return;
+	}
+
+	bool changed;
+	if( source.name.empty() ) {
+		changed = NDIlib_routing_clear( route.instance );
+	}
+	else {
+		NDIlib_source_t ndiSource;
+		ndiSource.p_ndi_name = source.name.c_str();
+		ndiSource.p_url_address = source.url.empty() ? NULL : source.url.c_str();
+		changed = NDIlib_routing_change( route.instance, &ndiSource );
+	}
+	if( ! changed ) {
+		CI_LOG_E( "Failed to change NDI route '" << name << "'" );
+		return;
+	}
+	CI_LOG_I( "NDI route '" << name << "' " << ( source.name.empty() ? "cleared" : "now points at '" + source.name + "'" ) );
+	route.source = source;
+}
+
+void CinderNDIRouter::onSourceEvent( CinderNDIDiscovery::Event event, const CinderNDIDiscovery::Source& source )
+{
+	std::lock_guard<std::mutex> lock( mRoutesMutex );
+	if( isOwnRoute( source ) ) {
+		return;
+	}
+
+	for( auto& route : mRoutes ) {
+		Route& current = route.second;
+		const bool isRouted = ! current.source.name.empty() && current.source.name == source.name;
+		if( current.pattern.empty() ) {
+			// a fixed source is only followed to its new address.
+			if( isRouted && event != CinderNDIDiscovery::Event::Removed ) {
+				change( route.first, current, source );
+			}
+		}
+		else if( isRouted || CinderNDISourceMatcher::matches( current.matchMode, current.pattern, source ) ) {
+			// the list the event came from is already in the matcher, so this also catches a second match.
+			resolve( route.first, current );
+		}
+	}
+}
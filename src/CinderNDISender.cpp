@@ -5,7 +5,13 @@
 
 #include <Processing.NDI.Send.h>
 
-CinderNDISender::CinderNDISender( const std::string name )
+#include <cstring>
+#include <algorithm>
+
+#include "CinderNDIFrameHash.h"
+#include "CinderNDIConvert.h"
+
+CinderNDISender::CinderNDISender( const std::string name, bool clockVideo )
 	: mName{ name }, mNdiSender{ nullptr }, mFramerateNumerator{ 60000 }, mFramerateDenominator{ 1001 }
 {
 	if( ! NDIlib_is_supported_CPU() ) {
@@ -16,12 +22,39 @@ CinderNDISender::CinderNDISender( const std::string name )
 		CI_LOG_E( "Failed to initialize NDI!" );
 	}
 
-	NDIlib_send_create_t NDI_send_create_desc = { mName.c_str(), nullptr, true, false };
+	NDIlib_send_create_t NDI_send_create_desc = { mName.c_str(), nullptr, clockVideo, false };
 	mNdiSender = NDIlib_send_create( &NDI_send_create_desc );
+
+	mPacingEnabled = false;
+	mPacingNumerator = 0;
+	mPacingDenominator = 0;
+	mHasInFlightFrame = false;
+	mNumRepeatedFrames = 0;
+	mNumDroppedFrames = 0;
+
+	mDeduplicationEnabled = false;
+	mNextFrameChanged = -1;
+	mKeepAliveInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::seconds( 1 ) ).count();
+	mLastSendTime = 0;
+	mLastFrameHash = 0;
+	mNumDeduplicatedFrames = 0;
+
+	mPictureAspectRatio = 0.0f;
+	mAlphaMode = AlphaMode::Keep;
+	mUYVAEnabled = false;
+	mConvertedFrameIndex = 0;
+
+	mOnProgram = false;
+	mOnPreview = false;
+	mIdleFrameInterval = 1;
+	mIdleHalfResolution = false;
+	mIdleSkipConversion = false;
 }
 
 CinderNDISender::~CinderNDISender()
 {
+	setPacingEnabled( false );
+
 	if( mNdiSender ) {
 		NDIlib_send_destroy( mNdiSender );
 	}
@@ -42,30 +75,97 @@ void CinderNDISender::sendSurface( ci::Surface& surface )
 
 void CinderNDISender::sendSurface( ci::Surface& surface, long long timecode, bool async )
 {
-	if( NDIlib_send_get_no_connections( mNdiSender, 0 ) ) {
+	sendSurface( surface, surface.getBounds(), timecode, false, async );
+}
+
+void CinderNDISender::sendSurface( ci::Surface& surface, const ci::Area& area, long long timecode, bool flipVertically, bool async )
+{
+	if( shouldSendFrame() ) {
 
 		NDIlib_metadata_frame_t metadata_desc;
 		/*if( NDIlib_send_capture( mNdiSender, &metadata_desc, 0 ) ) {
 			CI_LOG_I( "Received meta-data : " << metadata_desc.p_data );
 		}*/
 
+		const int channelOrder = surface.getChannelOrder().getCode();
+		const bool bgr = channelOrder == ci::SurfaceChannelOrder::BGRA || channelOrder == ci::SurfaceChannelOrder::BGRX;
+		const bool rgb = channelOrder == ci::SurfaceChannelOrder::RGBA || channelOrder == ci::SurfaceChannelOrder::RGBX;
+		if( ! bgr && ! rgb ) {
+			CI_LOG_E( "Only 4 channel RGBA/BGRA Surfaces can be sent over NDI" );
+			return;
+		}
+		const bool alpha = surface.hasAlpha();
+
+		ci::Area clipped = area;
+		clipped.clipBy( surface.getBounds() );
+		if( clipped.getWidth() <= 0 || clipped.getHeight() <= 0 ) {
+			return;
+		}
+
+		// point NDI straight at the area inside the Surface, bottom-up by starting at the last row
+		// and stepping backwards.
+		const ptrdiff_t rowBytes = surface.getRowBytes();
+		const int firstRow = flipVertically ? clipped.y2 - 1 : clipped.y1;
+		uint8_t* data = surface.getData() + firstRow * rowBytes + clipped.x1 * surface.getPixelInc();
 
 		NDIlib_video_frame_v2_t NDI_video_frame;
-		NDI_video_frame.xres = (unsigned int)( surface.getWidth() );
-		NDI_video_frame.yres = (unsigned int)( surface.getHeight() );
-		NDI_video_frame.FourCC = NDIlib_FourCC_type_BGRX;
-		NDI_video_frame.p_data = (uint8_t*)(surface.getData());
+		NDI_video_frame.xres = clipped.getWidth();
+		NDI_video_frame.yres = clipped.getHeight();
+		NDI_video_frame.FourCC = bgr ? ( alpha ? NDIlib_FourCC_type_BGRA : NDIlib_FourCC_type_BGRX ) : ( alpha ? NDIlib_FourCC_type_RGBA : NDIlib_FourCC_type_RGBX );
+		NDI_video_frame.p_data = data;
+		NDI_video_frame.line_stride_in_bytes = (int)( flipVertically ? -rowBytes : rowBytes );
 		NDI_video_frame.frame_rate_N = mFramerateNumerator;
 		NDI_video_frame.frame_rate_D = mFramerateDenominator;
-		
-		if( async ) {
-			NDIlib_send_send_video_async_v2( mNdiSender, &NDI_video_frame );
+		NDI_video_frame.picture_aspect_ratio = mPictureAspectRatio;
+		NDI_video_frame.frame_format_type = NDIlib_frame_format_type_progressive;
+		NDI_video_frame.timecode = timecode;
+
+		// each step writes the outgoing buffer when it is the last one, a scratch buffer otherwise.
+		const bool idle = isIdle();
+		const bool convertAlpha = alpha && mAlphaMode != AlphaMode::Keep && ! ( idle && mIdleSkipConversion );
+		const bool convertUYVA = alpha && bgr && mUYVAEnabled && ! ( idle && mIdleSkipConversion );
+		bool converted = false;
+		if( idle && mIdleHalfResolution && NDI_video_frame.xres >= 2 && NDI_video_frame.yres >= 2 ) {
+			auto& buffer = convertAlpha || convertUYVA ? mScaleScratch : mConvertedFrames[mConvertedFrameIndex];
+			const int width = NDI_video_frame.xres / 2, height = NDI_video_frame.yres / 2;
+			buffer.resize( (size_t)width * 4 * height );
+			CinderNDIConvert::scaleBGRA( NDI_video_frame.p_data, NDI_video_frame.line_stride_in_bytes, NDI_video_frame.xres, NDI_video_frame.yres, buffer.data(), width * 4, width, height );
+			NDI_video_frame.xres = width;
+			NDI_video_frame.yres = height;
+			NDI_video_frame.p_data = buffer.data();
+			NDI_video_frame.line_stride_in_bytes = width * 4;
+			converted = true;
+		}
+		if( convertAlpha ) {
+			// goes straight out unless it still has to be turned into UYVA.
+			auto& buffer = convertUYVA ? mAlphaScratch : mConvertedFrames[mConvertedFrameIndex];
+			const int stride = NDI_video_frame.xres * 4;
+			buffer.resize( (size_t)stride * NDI_video_frame.yres );
+			if( mAlphaMode == AlphaMode::Premultiply ) {
+				CinderNDIConvert::premultiplyBGRA( NDI_video_frame.p_data, NDI_video_frame.line_stride_in_bytes, NDI_video_frame.xres, NDI_video_frame.yres, buffer.data(), stride );
+			}
+			else {
+				CinderNDIConvert::unpremultiplyBGRA( NDI_video_frame.p_data, NDI_video_frame.line_stride_in_bytes, NDI_video_frame.xres, NDI_video_frame.yres, buffer.data(), stride );
+			}
+			NDI_video_frame.p_data = buffer.data();
+			NDI_video_frame.line_stride_in_bytes = stride;
+			converted = true;
 		}
-		else {
-			NDIlib_send_send_video_v2( mNdiSender, &NDI_video_frame );
+		if( convertUYVA ) {
+			auto& buffer = mConvertedFrames[mConvertedFrameIndex];
+			// whole pixel pairs per color row, and the alpha plane right behind them at half that stride.
+			const int stride = calcLineStride( NDI_video_frame.xres, NDIlib_FourCC_type_UYVA );
+			buffer.resize( (size_t)stride * NDI_video_frame.yres + (size_t)( stride / 2 ) * NDI_video_frame.yres );
+			CinderNDIConvert::bgraToUYVA( NDI_video_frame.p_data, NDI_video_frame.line_stride_in_bytes, NDI_video_frame.xres, NDI_video_frame.yres, buffer.data(), stride );
+			NDI_video_frame.FourCC = NDIlib_FourCC_type_UYVA;
+			NDI_video_frame.p_data = buffer.data();
+			NDI_video_frame.line_stride_in_bytes = stride;
+			converted = true;
+		}
+
+		if( sendVideoFrame( NDI_video_frame, async ) && converted ) {
+			mConvertedFrameIndex = 1 - mConvertedFrameIndex;
 		}
-		//if( timecode % 25 == 0 )
-		//	CI_LOG_I( ( NDI_tally.on_program ? "PGM " : "" ) << " " << ( NDI_tally.on_preview ? "PVW " : "" ) );
 	}
 	else {
 		//CI_LOG_I( "No connection, not sending frames." );
@@ -74,7 +174,296 @@ void CinderNDISender::sendSurface( ci::Surface& surface, long long timecode, boo
 
 void CinderNDISender::sendSurfaceForceSync()
 {
-	NDIlib_send_send_video_async( mNdiSender, NULL );
+	NDIlib_send_send_video_async_v2( mNdiSender, NULL );
+}
+
+bool CinderNDISender::hasConnections() const
+{
+	return NDIlib_send_get_no_connections( mNdiSender, 0 ) > 0;
+}
+
+void CinderNDISender::setFailover( const std::string& sourceName )
+{
+	if( sourceName.empty() ) {
+		NDIlib_send_set_failover( mNdiSender, NULL );
+		return;
+	}
+	const NDIlib_source_t NDI_failover_source( sourceName.c_str() );
+	NDIlib_send_set_failover( mNdiSender, &NDI_failover_source );
+}
+
+void CinderNDISender::setTallyCallback( const TallyCallback& callback )
+{
+	std::lock_guard<std::mutex> lock( mTallyMutex );
+	mTallyCallback = callback;
+}
+
+bool CinderNDISender::updateTally( uint32_t timeoutMs )
+{
+	NDIlib_tally_t NDI_tally;
+	NDIlib_send_get_tally( mNdiSender, &NDI_tally, timeoutMs );
+
+	TallyCallback callback;
+	{
+		std::lock_guard<std::mutex> lock( mTallyMutex );
+		if( NDI_tally.on_program == mOnProgram && NDI_tally.on_preview == mOnPreview ) {
+			return false;
+		}
+		mOnProgram = NDI_tally.on_program;
+		mOnPreview = NDI_tally.on_preview;
+		callback = mTallyCallback;
+	}
+
+	CI_LOG_I( "NDI sender '" << mName << "' tally changed to" << ( NDI_tally.on_program ? " program" : "" ) << ( NDI_tally.on_preview ? " preview" : "" ) << ( NDI_tally.on_program || NDI_tally.on_preview ? "" : " none" ) );
+	if( callback ) {
+		callback( NDI_tally.on_program, NDI_tally.on_preview );
+	}
+	return true;
+}
+
+void CinderNDISender::setIdlePolicy( const IdlePolicy& policy )
+{
+	mIdleFrameInterval = std::max( 1, policy.frameInterval );
+	mIdleHalfResolution = policy.halfResolution;
+	mIdleSkipConversion = policy.skipConversion;
+}
+
+CinderNDISender::IdlePolicy CinderNDISender::getIdlePolicy() const
+{
+	IdlePolicy policy;
+	policy.frameInterval = mIdleFrameInterval;
+	policy.halfResolution = mIdleHalfResolution;
+	policy.skipConversion = mIdleSkipConversion;
+	return policy;
+}
+
+bool CinderNDISender::isIdleThrottled() const
+{
+	const int interval = mIdleFrameInterval;
+	if( interval <= 1 || ! isIdle() || mFramerateNumerator <= 0 ) {
+		return false;
+	}
+	// half a frame of slack, so a caller running at the full rate lands on every interval-th frame.
+	const double minSeconds = ( interval - 0.5 ) * mFramerateDenominator / mFramerateNumerator;
+	auto lastSend = std::chrono::steady_clock::time_point( std::chrono::steady_clock::duration( mLastSendTime ) );
+	return std::chrono::duration<double>( std::chrono::steady_clock::now() - lastSend ).count() < minSeconds;
+}
+
+bool CinderNDISender::shouldSendFrame()
+{
+	if( ! NDIlib_send_get_no_connections( mNdiSender, 0 ) ) {
+		return false;
+	}
+	updateTally();
+	return ! isIdleThrottled();
+}
+
+int CinderNDISender::calcLineStride( int width, NDIlib_FourCC_type_e fourCC )
+{
+	switch( fourCC ) {
+		case NDIlib_FourCC_type_BGRA:
+		case NDIlib_FourCC_type_BGRX:
+		case NDIlib_FourCC_type_RGBA:
+		case NDIlib_FourCC_type_RGBX:
+			return width * 4;
+		case NDIlib_FourCC_type_UYVY:
+		case NDIlib_FourCC_type_UYVA:
+			// whole pixel pairs, an odd last pixel still takes a full U Y V Y group.
+			return ( ( width + 1 ) / 2 ) * 4;
+		default:
+			return 0;
+	}
+}
+
+bool CinderNDISender::sendVideoFrame( const NDIlib_video_frame_v2_t& videoFrame, bool async )
+{
+	if( ! shouldSendFrame() ) {
+		return false;
+	}
+
+	if( mDeduplicationEnabled && isDuplicateFrame( videoFrame ) ) {
+		++mNumDeduplicatedFrames;
+		return false;
+	}
+
+	if( mPacingEnabled ) {
+		copyPacedFrame( videoFrame );
+		return true;
+	}
+	return submitVideoFrame( videoFrame, async );
+}
+
+bool CinderNDISender::submitVideoFrame( const NDIlib_video_frame_v2_t& videoFrame, bool async )
+{
+	if( ! NDIlib_send_get_no_connections( mNdiSender, 0 ) ) {
+		return false;
+	}
+
+	NDIlib_video_frame_v2_t NDI_video_frame = videoFrame;
+	NDI_video_frame.frame_rate_N = mFramerateNumerator;
+	NDI_video_frame.frame_rate_D = mFramerateDenominator;
+
+	if( async ) {
+		NDIlib_send_send_video_async_v2( mNdiSender, &NDI_video_frame );
+	}
+	else {
+		NDIlib_send_send_video_v2( mNdiSender, &NDI_video_frame );
+	}
+	mLastSendTime = std::chrono::steady_clock::now().time_since_epoch().count();
+	return true;
+}
+
+void CinderNDISender::setDeduplicationEnabled( bool enabled, double keepAliveSeconds )
+{
+	mKeepAliveInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( keepAliveSeconds ) ).count();
+	mLastFrameHash = 0;
+	mDeduplicationEnabled = enabled;
+}
+
+bool CinderNDISender::isKeepAliveDue() const
+{
+	auto lastSend = std::chrono::steady_clock::time_point( std::chrono::steady_clock::duration( mLastSendTime ) );
+	return std::chrono::steady_clock::now() - lastSend >= std::chrono::steady_clock::duration( mKeepAliveInterval );
+}
+
+bool CinderNDISender::isDuplicateFrame( const NDIlib_video_frame_v2_t& videoFrame )
+{
+	bool changed;
+	const int hint = mNextFrameChanged.exchange( -1 );
+	if( hint >= 0 ) {
+		changed = hint == 1;
+		if( changed ) {
+			// the content is unknown now, the next hashed frame must not match against it.
+			mLastFrameHash = 0;
+		}
+	}
+	else {
+		int rowBytes = calcLineStride( videoFrame.xres, videoFrame.FourCC );
+		if( ! rowBytes ) {
+			return false;
+		}
+		int stride = videoFrame.line_stride_in_bytes ? videoFrame.line_stride_in_bytes : rowBytes;
+		uint64_t seed = ( (uint64_t)videoFrame.FourCC << 32 ) ^ (uint64_t)videoFrame.xres;
+		uint64_t hash = CinderNDIFrameHash::calc( videoFrame.p_data, rowBytes, videoFrame.yres, stride, seed );
+		if( videoFrame.FourCC == NDIlib_FourCC_type_UYVA ) {
+			hash = CinderNDIFrameHash::calc( videoFrame.p_data + (ptrdiff_t)videoFrame.yres * stride, rowBytes / 2, videoFrame.yres, stride / 2, hash );
+		}
+		changed = hash != mLastFrameHash;
+		mLastFrameHash = hash;
+	}
+
+	return ! changed && ! isKeepAliveDue();
+}
+
+void CinderNDISender::setPacingEnabled( bool enabled )
+{
+	if( enabled == mPacingEnabled ) {
+		return;
+	}
+
+	mPacingEnabled = enabled;
+	if( enabled ) {
+		mPacingNumerator = mFramerateNumerator;
+		mPacingDenominator = mFramerateDenominator;
+		mPacingClock.setRate( mPacingNumerator, mPacingDenominator );
+		mHasInFlightFrame = false;
+		if( ! mThreadPool ) {
+			mThreadPool = CinderNDIThreadPool::getDefault();
+		}
+		mPacingJob = mThreadPool->startJob( "NDI pacing " + mName, [this] { return pace(); }, true );
+	}
+	else if( mPacingJob ) {
+		mThreadPool->stopJob( mPacingJob );
+		mPacingJob.reset();
+		NDIlib_send_send_video_async_v2( mNdiSender, NULL );
+	}
+}
+
+void CinderNDISender::copyPacedFrame( const NDIlib_video_frame_v2_t& videoFrame )
+{
+	int rowBytes = calcLineStride( videoFrame.xres, videoFrame.FourCC );
+	if( ! rowBytes ) {
+		CI_LOG_E( "Can't pace NDI frames with FourCC " << videoFrame.FourCC );
+		return;
+	}
+	int srcStride = videoFrame.line_stride_in_bytes ? videoFrame.line_stride_in_bytes : rowBytes;
+
+	// copied straight into the caller's buffer of the triple buffer, the pacing job never waits on it.
+	const bool alphaPlane = videoFrame.FourCC == NDIlib_FourCC_type_UYVA;
+	const size_t colorBytes = (size_t)rowBytes * videoFrame.yres;
+	PacedFrame& frame = mPacedFrames.getWriteBuffer();
+	frame.videoFrame = videoFrame;
+	frame.videoFrame.line_stride_in_bytes = rowBytes;
+	frame.metadata.assign( videoFrame.p_metadata ? videoFrame.p_metadata : "" );
+	frame.data.resize( colorBytes + ( alphaPlane ? colorBytes / 2 : 0 ) );
+	if( srcStride == rowBytes ) {
+		std::memcpy( frame.data.data(), videoFrame.p_data, frame.data.size() );
+	}
+	else {
+		for( int y = 0; y < videoFrame.yres; ++y ) {
+			std::memcpy( frame.data.data() + (size_t)y * rowBytes, videoFrame.p_data + (ptrdiff_t)y * srcStride, rowBytes );
+		}
+		if( alphaPlane ) {
+			const uint8_t* srcAlpha = videoFrame.p_data + (ptrdiff_t)videoFrame.yres * srcStride;
+			for( int y = 0; y < videoFrame.yres; ++y ) {
+				std::memcpy( frame.data.data() + colorBytes + (size_t)y * rowBytes / 2, srcAlpha + (ptrdiff_t)y * srcStride / 2, rowBytes / 2 );
+			}
+		}
+	}
+
+	if( ! mPacedFrames.publish() ) {
+		++mNumDroppedFrames;
+	}
+}
+
+CinderNDIThreadPool::Clock::time_point CinderNDISender::pace()
+{
+	if( mPacingNumerator != mFramerateNumerator || mPacingDenominator != mFramerateDenominator ) {
+		mPacingNumerator = mFramerateNumerator;
+		mPacingDenominator = mFramerateDenominator;
+		mPacingClock.setRate( mPacingNumerator, mPacingDenominator );
+	}
+	// the pool runs the job a little ahead of the tick and the clock waits out the rest precisely.
+	mPacingClock.waitForNextTick();
+	const auto next = mPacingClock.getNextWakeTime();
+
+	// an idle output leaves the pending frame for the next tick that may send.
+	if( isIdleThrottled() ) {
+		return next;
+	}
+
+	// the newest frame takes the in-flight buffer's place and the old in-flight buffer goes back to the
+	// triple buffer, which only hands it to the caller again after the send below released it.
+	const bool fresh = mPacedFrames.update();
+	if( fresh ) {
+		std::swap( mPacedFrames.getReadBuffer(), mInFlightFrame );
+	}
+
+	PacedFrame& frame = mInFlightFrame;
+	if( ! fresh && ( ! mHasInFlightFrame || ( mDeduplicationEnabled && ! isKeepAliveDue() ) ) ) {
+		return next;
+	}
+
+	NDIlib_video_frame_v2_t NDI_video_frame = frame.videoFrame;
+	NDI_video_frame.p_data = frame.data.data();
+	NDI_video_frame.p_metadata = frame.metadata.empty() ? NULL : frame.metadata.c_str();
+	if( ! fresh ) {
+		NDI_video_frame.timecode = NDIlib_send_timecode_synthesize;
+	}
+
+	bool sent = submitVideoFrame( NDI_video_frame, true );
+	if( ! sent ) {
+		// nobody connected: make sure NDI holds none of our buffers before they get recycled.
+		NDIlib_send_send_video_async_v2( mNdiSender, NULL );
+	}
+
+	if( fresh ) {
+		mHasInFlightFrame = true;
+	}
+	else if( sent ) {
+		++mNumRepeatedFrames;
+	}
+	return next;
 }
 
 void CinderNDISender::sendMetadata( const ci::XmlTree& metadataString )
@@ -95,3 +484,21 @@ void CinderNDISender::sendMetadata( const ci::XmlTree& xmlTree, long long timeco
 		NDIlib_send_send_metadata( mNdiSender, &NDI_metadata );
 	}
 }
+
+bool CinderNDISender::sendMetadataFrame( const NDIlib_metadata_frame_t& metadataFrame )
+{
+	if( ! NDIlib_send_get_no_connections( mNdiSender, 0 ) ) {
+		return false;
+	}
+	NDIlib_send_send_metadata( mNdiSender, &metadataFrame );
+	return true;
+}
+
+bool CinderNDISender::sendAudioFrame( const NDIlib_audio_frame_v2_t& audioFrame )
+{
+	if( ! NDIlib_send_get_no_connections( mNdiSender, 0 ) ) {
+		return false;
+	}
+	NDIlib_send_send_audio_v2( mNdiSender, &audioFrame );
+	return true;
+}
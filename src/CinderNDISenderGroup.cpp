@@ -0,0 +1,177 @@
+#include "CinderNDISenderGroup.h"
+
+#include "cinder/Log.h"
+
+#include "CinderNDIConvert.h"
+
+CinderNDISenderGroup::CinderNDISenderGroup()
+{
+}
+
+size_t CinderNDISenderGroup::addOutput( const Output& requested )
+{
+	Output output = requested;
+	if( output.fourCC != NDIlib_FourCC_type_BGRX && output.fourCC != NDIlib_FourCC_type_BGRA && output.fourCC != NDIlib_FourCC_type_UYVY && output.fourCC != NDIlib_FourCC_type_UYVA ) {
+		CI_LOG_E( "Unsupported FourCC for NDI output '" << output.name << "', falling back to BGRX" );
+		output.fourCC = NDIlib_FourCC_type_BGRX;
+	}
+
+	OutputState state( output );
+	state.sender.reset( new CinderNDISender( output.name ) );
+
+	// share the scaled image with any output using the same crop and size.
+	state.stage = mStages.size();
+	for( size_t i = 0; i < mStages.size(); ++i ) {
+		if( mStages[i].crop == output.crop && mStages[i].size.x == output.size.x && mStages[i].size.y == output.size.y ) {
+			state.stage = i;
+			break;
+		}
+	}
+	if( state.stage == mStages.size() ) {
+		Stage stage;
+		stage.crop = output.crop;
+		stage.size = output.size;
+		stage.pixels = nullptr;
+		stage.stride = 0;
+		stage.width = 0;
+		stage.height = 0;
+		stage.needed = false;
+		mStages.push_back( stage );
+	}
+
+	if( output.fourCC == NDIlib_FourCC_type_UYVY || output.fourCC == NDIlib_FourCC_type_UYVA ) {
+		state.conversion = (int)mConversions.size();
+		for( size_t i = 0; i < mConversions.size(); ++i ) {
+			if( mConversions[i].stage == state.stage && mConversions[i].fourCC == output.fourCC ) {
+				state.conversion = (int)i;
+				break;
+			}
+		}
+		if( state.conversion == (int)mConversions.size() ) {
+			Conversion conversion;
+			conversion.stage = state.stage;
+			conversion.fourCC = output.fourCC;
+			conversion.stride = 0;
+			conversion.needed = false;
+			mConversions.push_back( conversion );
+		}
+	}
+
+	mOutputs.push_back( std::move( state ) );
+	return mOutputs.size() - 1;
+}
+
+void CinderNDISenderGroup::setFramerate( int numerator, int denominator )
+{
+	for( auto& output : mOutputs ) {
+		output.sender->setFramerate( numerator, denominator );
+	}
+}
+
+void CinderNDISenderGroup::sendSurface( const ci::Surface8u& surface, long long timecode )
+{
+	if( surface.getChannelOrder().getCode() != ci::SurfaceChannelOrder::BGRA && surface.getChannelOrder().getCode() != ci::SurfaceChannelOrder::BGRX ) {
+		CI_LOG_E( "NDI sender group expects a BGRA or BGRX Surface" );
+		return;
+	}
+
+	// only produce what an output is going to send, unconnected and throttled idle outputs are skipped.
+	std::vector<bool> connected( mOutputs.size() );
+	for( auto& stage : mStages ) {
+		stage.needed = false;
+	}
+	for( auto& conversion : mConversions ) {
+		conversion.needed = false;
+	}
+	for( size_t i = 0; i < mOutputs.size(); ++i ) {
+		connected[i] = mOutputs[i].sender->shouldSendFrame();
+		if( connected[i] ) {
+			mStages[mOutputs[i].stage].needed = true;
+			if( mOutputs[i].conversion >= 0 ) {
+				mConversions[mOutputs[i].conversion].needed = true;
+			}
+		}
+	}
+
+	const ci::Area bounds = surface.getBounds();
+	for( auto& stage : mStages ) {
+		if( ! stage.needed ) {
+			continue;
+		}
+
+		ci::Area crop = stage.crop.calcArea() > 0 ? stage.crop : bounds;
+		crop.clipBy( bounds );
+		if( crop.getWidth() <= 0 || crop.getHeight() <= 0 ) {
+			// the crop lies outside this Surface, there is nothing to send for its outputs.
+			stage.needed = false;
+			continue;
+		}
+		int width = stage.size.x > 0 ? stage.size.x : crop.getWidth();
+		int height = stage.size.y > 0 ? stage.size.y : crop.getHeight();
+		const uint8_t* cropPixels = surface.getData( crop.getUL() );
+
+		if( width == crop.getWidth() && height == crop.getHeight() ) {
+			stage.pixels = cropPixels;
+			stage.stride = surface.getRowBytes();
+		}
+		else {
+			stage.stride = width * 4;
+			stage.data.resize( (size_t)stage.stride * height );
+			CinderNDIConvert::scaleBGRA( cropPixels, surface.getRowBytes(), crop.getWidth(), crop.getHeight(), stage.data.data(), stage.stride, width, height );
+			stage.pixels = stage.data.data();
+		}
+		stage.width = width;
+		stage.height = height;
+
+		for( auto& conversion : mConversions ) {
+			if( conversion.needed && &mStages[conversion.stage] == &stage ) {
+				conversion.stride = CinderNDISender::calcLineStride( width, conversion.fourCC );
+				if( conversion.fourCC == NDIlib_FourCC_type_UYVA ) {
+					conversion.data.resize( (size_t)conversion.stride * height + (size_t)( conversion.stride / 2 ) * height );
+					CinderNDIConvert::bgraToUYVA( stage.pixels, stage.stride, width, height, conversion.data.data(), conversion.stride );
+				}
+				else {
+					conversion.data.resize( (size_t)conversion.stride * height );
+					CinderNDIConvert::bgraToUYVY( stage.pixels, stage.stride, width, height, conversion.data.data(), conversion.stride );
+				}
+			}
+		}
+	}
+
+	// submit everything asynchronously so NDI compresses the outputs in parallel, then wait for all
+	// of them so the shared buffers and the source can be reused as soon as we return.
+	for( size_t i = 0; i < mOutputs.size(); ++i ) {
+		if( connected[i] && ! mStages[mOutputs[i].stage].needed ) {
+			connected[i] = false;
+		}
+		if( ! connected[i] ) {
+			continue;
+		}
+
+		auto& output = mOutputs[i];
+		const Stage& stage = mStages[output.stage];
+
+		NDIlib_video_frame_v2_t NDI_video_frame;
+		NDI_video_frame.xres = stage.width;
+		NDI_video_frame.yres = stage.height;
+		NDI_video_frame.FourCC = output.output.fourCC;
+		NDI_video_frame.frame_format_type = NDIlib_frame_format_type_progressive;
+		NDI_video_frame.timecode = timecode;
+		if( output.conversion >= 0 ) {
+			const Conversion& conversion = mConversions[output.conversion];
+			NDI_video_frame.p_data = const_cast<uint8_t*>( conversion.data.data() );
+			NDI_video_frame.line_stride_in_bytes = conversion.stride;
+		}
+		else {
+			NDI_video_frame.p_data = const_cast<uint8_t*>( stage.pixels );
+			NDI_video_frame.line_stride_in_bytes = (int)stage.stride;
+		}
+		output.sender->sendVideoFrame( NDI_video_frame, true );
+	}
+
+	for( size_t i = 0; i < mOutputs.size(); ++i ) {
+		if( connected[i] ) {
+			mOutputs[i].sender->sendSurfaceForceSync();
+		}
+	}
+}
@@ -0,0 +1,194 @@
+#include "CinderNDISourceMatcher.h"
+
+#include <regex>
+#include <cctype>
+#include <algorithm>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "cinder/Log.h"
+
+bool CinderNDISourceMatcher::splitName( const std::string& fullName, std::string& machine, std::string& stream )
+{
+	// stream names may contain parentheses themselves, the machine name can't.
+	const size_t open = fullName.find( " (" );
+	if( open == std::string::npos || fullName.empty() || fullName.back() != ')' ) {
+		return false;
+	}
+	machine = fullName.substr( 0, open );
+	stream = fullName.substr( open + 2, fullName.size() - open - 3 );
+	return true;
+}
+
+std::string CinderNDISourceMatcher::getLocalMachine()
+{
+	// NDI names sources after the computer name on Windows and the host name without its domain elsewhere.
+	std::string machine;
+#if defined( _WIN32 )
+	char name[MAX_COMPUTERNAME_LENGTH + 1];
+	DWORD size = sizeof( name );
+	if( GetComputerNameA( name, &size ) ) {
+		machine.assign( name, size );
+	}
+#else
+	char name[256] = {};
+	if( gethostname( name, sizeof( name ) - 1 ) == 0 ) {
+		machine = name;
+		machine = machine.substr( 0, machine.find( '.' ) );
+	}
+#endif
+	std::transform( machine.begin(), machine.end(), machine.begin(), []( char c ) { return (char)std::tolower( (unsigned char)c ); } );
+	return machine;
+}
+
+std::string CinderNDISourceMatcher::normalizeFullName( const std::string& fullName )
+{
+	std::string machine, stream;
+	if( ! splitName( fullName, machine, stream ) ) {
+		return fullName;
+	}
+	std::transform( machine.begin(), machine.end(), machine.begin(), []( char c ) { return (char)std::tolower( (unsigned char)c ); } );
+	return machine + " (" + stream + ")";
+}
+
+std::string CinderNDISourceMatcher::getHost( const std::string& url )
+{
+	const size_t colon = url.rfind( ':' );
+	return colon == std::string::npos ? url : url.substr( 0, colon );
+}
+
+void CinderNDISourceMatcher::update( const std::vector<CinderNDIDiscovery::Source>& sources )
+{
+	mSources = sources;
+	mByStream.clear();
+	mByFullName.clear();
+	mByUrl.clear();
+	mByHost.clear();
+	mSorted.clear();
+
+	for( size_t i = 0; i < mSources.size(); ++i ) {
+		const auto& source = mSources[i];
+		std::string machine, stream;
+		mByStream.insert( std::make_pair( splitName( source.name, machine, stream ) ? stream : source.name, i ) );
+		mByFullName.insert( std::make_pair( normalizeFullName( source.name ), i ) );
+		mSorted.insert( std::make_pair( source.name, i ) );
+		if( ! source.url.empty() ) {
+			mByUrl.insert( std::make_pair( source.url, i ) );
+			mByHost.insert( std::make_pair( getHost( source.url ), i ) );
+		}
+	}
+}
+
+bool CinderNDISourceMatcher::matches( Mode mode, const std::string& pattern, const CinderNDIDiscovery::Source& source )
+{
+	std::string machine, stream;
+	switch( mode ) {
+		case Mode::Exact:
+			return ( splitName( source.name, machine, stream ) ? stream : source.name ) == pattern;
+		case Mode::MachineAndName:
+			return normalizeFullName( source.name ) == normalizeFullName( pattern );
+		case Mode::Prefix:
+			return source.name.compare( 0, pattern.size(), pattern ) == 0;
+		case Mode::Regex:
+			try {
+				return std::regex_match( source.name, std::regex( pattern ) );
+			}
+			catch( const std::regex_error& e ) {
+				CI_LOG_E( "Invalid NDI source expression '" << pattern << "': " << e.what() );
+				return false;
+			}
+		case Mode::Url:
+			return ! source.url.empty() && ( source.url == pattern || getHost( source.url ) == pattern );
+		case Mode::Contains:
+			return source.name.find( pattern ) != std::string::npos;
+	}
+	return false;
+}
+
+void CinderNDISourceMatcher::findIndices( Mode mode, const std::string& pattern, std::vector<size_t>& indices, size_t maxCount ) const
+{
+	auto collect = [&]( const std::unordered_multimap<std::string, size_t>& index, const std::string& key ) {
+		auto range = index.equal_range( key );
+		for( auto it = range.first; it != range.second && indices.size() < maxCount; ++it ) {
+			indices.push_back( it->second );
+		}
+	};
+
+	switch( mode ) {
+		case Mode::Exact:
+			collect( mByStream, pattern );
+			break;
+		case Mode::MachineAndName:
+			collect( mByFullName, normalizeFullName( pattern ) );
+			break;
+		case Mode::Prefix:
+			for( auto it = mSorted.lower_bound( pattern ); it != mSorted.end() && indices.size() < maxCount && it->first.compare( 0, pattern.size(), pattern ) == 0; ++it ) {
+				indices.push_back( it->second );
+			}
+			break;
+		case Mode::Url:
+			collect( pattern.find( ':' ) != std::string::npos ? mByUrl : mByHost, pattern );
+			break;
+		case Mode::Regex: {
+			std::regex expression;
+			try {
+				expression = std::regex( pattern );
+			}
+			catch( const std::regex_error& e ) {
+				CI_LOG_E( "Invalid NDI source expression '" << pattern << "': " << e.what() );
+				return;
+			}
+			for( size_t i = 0; i < mSources.size() && indices.size() < maxCount; ++i ) {
+				if( std::regex_match( mSources[i].name, expression ) ) {
+					indices.push_back( i );
+				}
+			}
+			break;
+		}
+		case Mode::Contains:
+			for( size_t i = 0; i < mSources.size() && indices.size() < maxCount; ++i ) {
+				if( mSources[i].name.find( pattern ) != std::string::npos ) {
+					indices.push_back( i );
+				}
+			}
+			break;
+	}
+}
+
+CinderNDISourceMatcher::Result CinderNDISourceMatcher::find( Mode mode, const std::string& pattern, CinderNDIDiscovery::Source& source ) const
+{
+	// a second hit is all it takes to know the pattern is ambiguous.
+	std::vector<size_t> indices;
+	findIndices( mode, pattern, indices, 2 );
+	if( indices.empty() ) {
+		return Result::NotFound;
+	}
+	if( indices.size() > 1 ) {
+		return Result::Ambiguous;
+	}
+	source = mSources[indices[0]];
+	return Result::Found;
+}
+
+int CinderNDISourceMatcher::findIndex( Mode mode, const std::string& pattern ) const
+{
+	std::vector<size_t> indices;
+	findIndices( mode, pattern, indices, 2 );
+	return indices.size() == 1 ? (int)indices[0] : -1;
+}
+
+std::vector<CinderNDIDiscovery::Source> CinderNDISourceMatcher::findAll( Mode mode, const std::string& pattern ) const
+{
+	std::vector<size_t> indices;
+	findIndices( mode, pattern, indices, mSources.size() );
+	std::sort( indices.begin(), indices.end() );
+	std::vector<CinderNDIDiscovery::Source> sources;
+	for( auto index : indices ) {
+		sources.push_back( mSources[index] );
+	}
+	return sources;
+}
@@ -0,0 +1,235 @@
+#include "CinderNDITestPattern.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#include "CinderNDISender.h"
+
+namespace {
+
+const uint8_t kMarkerSync = 0xB2;
+
+// 75% bars: white, yellow, cyan, green, magenta, red, blue in BGR order.
+const uint8_t kBars[7][3] = {
+	{ 191, 191, 191 }, { 0, 191, 191 }, { 191, 191, 0 }, { 0, 191, 0 }, { 191, 0, 191 }, { 0, 0, 191 }, { 191, 0, 0 }
+};
+
+uint16_t calcCheck( uint64_t counter, uint64_t timestamp )
+{
+	uint16_t check = 0x5A5A;
+	for( int i = 0; i < 4; ++i ) {
+		check ^= (uint16_t)( counter >> ( i * 16 ) ) ^ (uint16_t)( timestamp >> ( i * 16 ) );
+	}
+	return check;
+}
+
+// the marker payload, most significant bit first.
+bool getMarkerBit( int bit, uint64_t counter, uint64_t timestamp, uint16_t check )
+{
+	if( bit < 8 ) {
+		return ( kMarkerSync >> ( 7 - bit ) ) & 1;
+	}
+	if( bit < 72 ) {
+		return ( counter >> ( 71 - bit ) ) & 1;
+	}
+	if( bit < 136 ) {
+		return ( timestamp >> ( 135 - bit ) ) & 1;
+	}
+	return ( check >> ( 151 - bit ) ) & 1;
+}
+
+} // anonymous namespace
+
+CinderNDITestPattern::CinderNDITestPattern( int width, int height, Pattern pattern )
+	: mWidth{ width }, mHeight{ height }, mBufferIndex{ 0 }, mFrameIndex{ 0 }
+{
+	for( int i = 0; i < 1024; ++i ) {
+		mSine[i] = (uint8_t)std::lround( 127.5 + 127.5 * std::sin( i * 2.0 * 3.14159265358979323846 / 1024.0 ) );
+	}
+
+	// phase in 1/1024 cycles, spaced so the rings reach the Nyquist limit at the far edge.
+	const int64_t maxDimension = std::max( 1, std::max( mWidth, mHeight ) );
+	mZoneTermsX.resize( mWidth );
+	for( int x = 0; x < mWidth; ++x ) {
+		const int64_t dx = x - mWidth / 2;
+		mZoneTermsX[x] = (uint32_t)( 512 * dx * dx / maxDimension );
+	}
+	setPattern( pattern );
+}
+
+void CinderNDITestPattern::setPattern( Pattern pattern )
+{
+	mPattern = pattern;
+}
+
+uint64_t CinderNDITestPattern::now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+}
+
+int CinderNDITestPattern::calcMarkerHeight( int width )
+{
+	const int bitsPerRow = width / kMarkerBlockSize;
+	if( bitsPerRow <= 0 ) {
+		return 0;
+	}
+	return ( ( kMarkerBits + bitsPerRow - 1 ) / bitsPerRow ) * kMarkerBlockSize;
+}
+
+void CinderNDITestPattern::renderRow( std::vector<uint8_t>& row, uint64_t frameIndex )
+{
+	row.resize( (size_t)mWidth * 4 );
+	uint8_t* p = row.data();
+	for( int x = 0; x < mWidth; ++x, p += 4 ) {
+		if( mPattern == Pattern::Bars ) {
+			const uint8_t* bar = kBars[std::min( 6, x * 7 / std::max( 1, mWidth ) )];
+			p[0] = bar[0];
+			p[1] = bar[1];
+			p[2] = bar[2];
+		}
+		else if( mPattern == Pattern::Ramp ) {
+			p[0] = p[1] = p[2] = (uint8_t)( x * 255 / std::max( 1, mWidth - 1 ) );
+		}
+		else {
+			const int edge = (int)( ( frameIndex * 8 ) % (uint64_t)std::max( 1, mWidth ) );
+			p[0] = p[1] = p[2] = x < edge ? 255 : 0;
+		}
+		p[3] = 255;
+	}
+}
+
+void CinderNDITestPattern::renderZonePlate( uint64_t frameIndex, uint8_t* dst, ptrdiff_t stride, int firstRow )
+{
+	const int64_t maxDimension = std::max( 1, std::max( mWidth, mHeight ) );
+	const uint32_t phase = (uint32_t)( frameIndex * 16 );
+	for( int y = firstRow; y < mHeight; ++y ) {
+		const int64_t dy = y - mHeight / 2;
+		const uint32_t termY = (uint32_t)( 512 * dy * dy / maxDimension ) + phase;
+		uint8_t* p = dst + (ptrdiff_t)y * stride;
+		for( int x = 0; x < mWidth; ++x, p += 4 ) {
+			p[0] = p[1] = p[2] = mSine[( mZoneTermsX[x] + termY ) & 1023];
+			p[3] = 255;
+		}
+	}
+}
+
+void CinderNDITestPattern::render( uint64_t frameIndex, uint64_t timestamp, uint8_t* dst, ptrdiff_t stride )
+{
+	const int markerHeight = std::min( mHeight, calcMarkerHeight( mWidth ) );
+
+	if( mPattern == Pattern::ZonePlate ) {
+		renderZonePlate( frameIndex, dst, stride, markerHeight );
+	}
+	else {
+		// every other pattern is constant down the frame, so one row is drawn and copied.
+		renderRow( mRow, frameIndex );
+		for( int y = markerHeight; y < mHeight; ++y ) {
+			std::memcpy( dst + (ptrdiff_t)y * stride, mRow.data(), mRow.size() );
+		}
+	}
+
+	if( markerHeight == calcMarkerHeight( mWidth ) ) {
+		stampMarker( dst, stride, mWidth, frameIndex, timestamp );
+	}
+}
+
+void CinderNDITestPattern::stampMarker( uint8_t* bgra, ptrdiff_t stride, int width, uint64_t counter, uint64_t timestamp )
+{
+	const int bitsPerRow = width / kMarkerBlockSize;
+	const int markerHeight = calcMarkerHeight( width );
+	if( ! markerHeight ) {
+		return;
+	}
+
+	const uint16_t check = calcCheck( counter, timestamp );
+	for( int y = 0; y < markerHeight; ++y ) {
+		uint32_t* row = reinterpret_cast<uint32_t*>( bgra + (ptrdiff_t)y * stride );
+		const int firstBit = ( y / kMarkerBlockSize ) * bitsPerRow;
+		for( int x = 0; x < width; ++x ) {
+			const int bit = firstBit + x / kMarkerBlockSize;
+			const bool set = x / kMarkerBlockSize < bitsPerRow && bit < kMarkerBits && getMarkerBit( bit, counter, timestamp, check );
+			row[x] = set ? 0xFFFFFFFF : 0xFF000000;
+		}
+	}
+}
+
+bool CinderNDITestPattern::readMarker( const NDIlib_video_frame_v2_t& videoFrame, uint64_t& counter, uint64_t& timestamp )
+{
+	// offset and step of a luma-like byte for each format.
+	int lumaOffset, pixelBytes;
+	switch( videoFrame.FourCC ) {
+		case NDIlib_FourCC_type_BGRA:
+		case NDIlib_FourCC_type_BGRX:
+		case NDIlib_FourCC_type_RGBA:
+		case NDIlib_FourCC_type_RGBX:
+			lumaOffset = 1;
+			pixelBytes = 4;
+			break;
+		case NDIlib_FourCC_type_UYVY:
+		case NDIlib_FourCC_type_UYVA:
+			lumaOffset = 1;
+			pixelBytes = 2;
+			break;
+		default:
+			return false;
+	}
+
+	const int markerHeight = calcMarkerHeight( videoFrame.xres );
+	if( ! markerHeight || videoFrame.yres < markerHeight || ! videoFrame.p_data ) {
+		return false;
+	}
+
+	const int bitsPerRow = videoFrame.xres / kMarkerBlockSize;
+	const ptrdiff_t stride = videoFrame.line_stride_in_bytes ? videoFrame.line_stride_in_bytes : (ptrdiff_t)videoFrame.xres * pixelBytes;
+	uint64_t values[4] = { 0, 0, 0, 0 };		// sync, counter, timestamp, check
+	for( int bit = 0; bit < kMarkerBits; ++bit ) {
+		// sample the center of the block, away from compression ringing at its edges.
+		const int x = ( bit % bitsPerRow ) * kMarkerBlockSize + kMarkerBlockSize / 2;
+		const int y = ( bit / bitsPerRow ) * kMarkerBlockSize + kMarkerBlockSize / 2;
+		const bool set = videoFrame.p_data[(ptrdiff_t)y * stride + x * pixelBytes + lumaOffset] >= 128;
+		const int field = bit < 8 ? 0 : ( bit < 72 ? 1 : ( bit < 136 ? 2 : 3 ) );
+		values[field] = ( values[field] << 1 ) | ( set ? 1 : 0 );
+	}
+
+	if( values[0] != kMarkerSync || values[3] != calcCheck( values[1], values[2] ) ) {
+		return false;
+	}
+	counter = values[1];
+	timestamp = values[2];
+	return true;
+}
+
+bool CinderNDITestPattern::send( CinderNDISender& sender, bool async )
+{
+	const int stride = mWidth * 4;
+	auto& buffer = mBuffers[mBufferIndex];
+	buffer.resize( (size_t)stride * mHeight );
+
+	const uint64_t timestamp = now();
+	render( mFrameIndex, timestamp, buffer.data(), stride );
+
+	char metadata[128];
+	std::snprintf( metadata, sizeof( metadata ), "<ndi_test_pattern frame=\"%llu\" timestamp=\"%llu\"/>", (unsigned long long)mFrameIndex, (unsigned long long)timestamp );
+	mMetadata[mBufferIndex] = metadata;
+
+	NDIlib_video_frame_v2_t NDI_video_frame;
+	NDI_video_frame.xres = mWidth;
+	NDI_video_frame.yres = mHeight;
+	NDI_video_frame.FourCC = NDIlib_FourCC_type_BGRX;
+	NDI_video_frame.frame_rate_N = sender.getFramerateNumerator();
+	NDI_video_frame.frame_rate_D = sender.getFramerateDenominator();
+	NDI_video_frame.frame_format_type = NDIlib_frame_format_type_progressive;
+	NDI_video_frame.p_data = buffer.data();
+	NDI_video_frame.line_stride_in_bytes = stride;
+	NDI_video_frame.p_metadata = mMetadata[mBufferIndex].c_str();
+
+	if( ! sender.sendVideoFrame( NDI_video_frame, async ) ) {
+		return false;
+	}
+	mBufferIndex = 1 - mBufferIndex;
+	++mFrameIndex;
+	return true;
+}
@@ -0,0 +1,95 @@
+#include "CinderNDITestPatternAnalyzer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "CinderNDITestPattern.h"
+
+CinderNDITestPatternAnalyzer::CinderNDITestPatternAnalyzer()
+{
+	reset();
+}
+
+void CinderNDITestPatternAnalyzer::reset()
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	mStats = Stats();
+	mHasLastCounter = false;
+	mLastCounter = 0;
+	mLatencyTotal = 0.0;
+	mNumLatencies = 0;
+}
+
+bool CinderNDITestPatternAnalyzer::readMetadata( const char* metadata, uint64_t& counter, uint64_t& timestamp )
+{
+	if( ! metadata ) {
+		return false;
+	}
+	const char* element = std::strstr( metadata, "<ndi_test_pattern " );
+	if( ! element ) {
+		return false;
+	}
+	unsigned long long frame, stamp;
+	if( std::sscanf( element, "<ndi_test_pattern frame=\"%llu\" timestamp=\"%llu\"", &frame, &stamp ) != 2 ) {
+		return false;
+	}
+	counter = frame;
+	timestamp = stamp;
+	return true;
+}
+
+bool CinderNDITestPatternAnalyzer::analyze( const NDIlib_video_frame_v2_t& videoFrame )
+{
+	const uint64_t receiveTime = CinderNDITestPattern::now();
+
+	uint64_t markerCounter = 0, markerTimestamp = 0, metadataCounter = 0, metadataTimestamp = 0;
+	const bool hasMarker = CinderNDITestPattern::readMarker( videoFrame, markerCounter, markerTimestamp );
+	const bool hasMetadata = readMetadata( videoFrame.p_metadata, metadataCounter, metadataTimestamp );
+
+	std::lock_guard<std::mutex> lock( mMutex );
+	++mStats.framesAnalyzed;
+	if( ! hasMarker && ! hasMetadata ) {
+		return false;
+	}
+	if( hasMarker && hasMetadata && ( markerCounter != metadataCounter || markerTimestamp != metadataTimestamp ) ) {
+		++mStats.markerMismatches;
+	}
+
+	// the pixels are what the viewer sees, so they win over the metadata.
+	const uint64_t counter = hasMarker ? markerCounter : metadataCounter;
+	const uint64_t timestamp = hasMarker ? markerTimestamp : metadataTimestamp;
+	++mStats.framesDecoded;
+
+	if( mHasLastCounter ) {
+		if( counter == mLastCounter ) {
+			++mStats.framesDuplicated;
+		}
+		else if( counter < mLastCounter ) {
+			++mStats.framesReordered;
+		}
+		else {
+			mStats.framesDropped += counter - mLastCounter - 1;
+		}
+	}
+	// a late frame from the past mustn't rewind the sequence and turn the following frames into drops.
+	if( ! mHasLastCounter || counter > mLastCounter ) {
+		mLastCounter = counter;
+	}
+	mHasLastCounter = true;
+
+	// clocks of different hosts may put the receive time before the stamp, clamp instead of wrapping.
+	const double latency = receiveTime > timestamp ? ( receiveTime - timestamp ) * 1e-6 : 0.0;
+	mLatencyTotal += latency;
+	++mNumLatencies;
+	mStats.meanLatency = mLatencyTotal / mNumLatencies;
+	mStats.minLatency = mNumLatencies == 1 ? latency : std::min( mStats.minLatency, latency );
+	mStats.maxLatency = std::max( mStats.maxLatency, latency );
+	return true;
+}
+
+CinderNDITestPatternAnalyzer::Stats CinderNDITestPatternAnalyzer::getStats() const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	return mStats;
+}
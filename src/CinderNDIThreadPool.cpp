@@ -0,0 +1,401 @@
+#include "CinderNDIThreadPool.h"
+
+#include <algorithm>
+
+#include "cinder/Log.h"
+
+#if defined( _WIN32 )
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment( lib, "winmm.lib" )
+#elif defined( __linux__ )
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+std::mutex sDefaultMutex;
+CinderNDIThreadPool::Options sDefaultOptions;
+
+void beginPreciseTiming()
+{
+#if defined( _WIN32 )
+	timeBeginPeriod( 1 );
+#endif
+}
+
+void endPreciseTiming()
+{
+#if defined( _WIN32 )
+	timeEndPeriod( 1 );
+#endif
+}
+
+void updateMax( std::atomic<uint64_t>& max, uint64_t value )
+{
+	uint64_t current = max;
+	while( value > current && ! max.compare_exchange_weak( current, value ) ) {
+	}
+}
+
+} // anonymous namespace
+
+const CinderNDIThreadPool::Clock::time_point CinderNDIThreadPool::kStop = CinderNDIThreadPool::Clock::time_point::max();
+
+CinderNDIThreadPool::Job::Job( const std::string& name, const Step& step )
+	: mName{ name }, mStep{ step }, mStopped{ false }, mPreciseTiming{ false }, mDueTime{ Clock::now() },
+	mNumRuns{ 0 }, mTotalNanos{ 0 }, mMaxNanos{ 0 }, mMaxLatenessNanos{ 0 }
+{
+}
+
+CinderNDIThreadPool::CinderNDIThreadPool( const Options& options )
+	: mOptions{ options }, mNextWorker{ 0 }, mNumQueued{ 0 }, mQuit{ false }
+{
+	size_t numThreads = options.numThreads > 0 ? (size_t)options.numThreads : (size_t)std::thread::hardware_concurrency();
+	numThreads = std::max<size_t>( numThreads, 1 );
+
+	// all queues exist before the first thread may steal from them.
+	for( size_t i = 0; i < numThreads; ++i ) {
+		mWorkers.emplace_back( new Worker );
+	}
+	for( size_t i = 0; i < numThreads; ++i ) {
+		mWorkers[i]->thread = std::thread( &CinderNDIThreadPool::threadedWork, this, i );
+	}
+	for( int i = 0; i < options.numBlockingThreads; ++i ) {
+		mLanes.emplace_back( new Lane );
+	}
+}
+
+CinderNDIThreadPool::~CinderNDIThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		std::lock_guard<std::mutex> lanesLock( mLanesMutex );
+		mQuit = true;
+	}
+	mCondition.notify_all();
+	mLanesCondition.notify_all();
+	for( auto& worker : mWorkers ) {
+		worker->thread.join();
+	}
+	for( auto& lane : mLanes ) {
+		if( lane->thread.joinable() ) {
+			lane->thread.join();
+		}
+	}
+	for( const auto& known : mJobs ) {
+		auto job = known.lock();
+		if( job ) {
+			releasePreciseTiming( *job );
+		}
+	}
+}
+
+std::shared_ptr<CinderNDIThreadPool> CinderNDIThreadPool::getDefault()
+{
+	static std::weak_ptr<CinderNDIThreadPool> sDefault;
+
+	std::lock_guard<std::mutex> lock( sDefaultMutex );
+	auto pool = sDefault.lock();
+	if( ! pool ) {
+		pool = std::make_shared<CinderNDIThreadPool>( sDefaultOptions );
+		sDefault = pool;
+	}
+	return pool;
+}
+
+void CinderNDIThreadPool::setDefaultOptions( const Options& options )
+{
+	std::lock_guard<std::mutex> lock( sDefaultMutex );
+	sDefaultOptions = options;
+}
+
+std::shared_ptr<CinderNDIThreadPool::Job> CinderNDIThreadPool::createJob( const std::string& name, const Step& step )
+{
+	auto job = std::make_shared<Job>( name, step );
+	std::lock_guard<std::mutex> lock( mJobsMutex );
+	// forget jobs that are gone while we are here anyway.
+	mJobs.erase( std::remove_if( mJobs.begin(), mJobs.end(), []( const std::weak_ptr<Job>& known ) { return known.expired(); } ), mJobs.end() );
+	mJobs.push_back( job );
+	return job;
+}
+
+std::shared_ptr<CinderNDIThreadPool::Job> CinderNDIThreadPool::startJob( const std::string& name, const Step& step, bool preciseTiming )
+{
+	auto job = createJob( name, step );
+	if( preciseTiming ) {
+		job->mPreciseTiming = true;
+		beginPreciseTiming();
+	}
+	enqueue( mNextWorker++ % mWorkers.size(), job );
+	return job;
+}
+
+std::shared_ptr<CinderNDIThreadPool::Job> CinderNDIThreadPool::startBlockingJob( const std::string& name, const BlockingStep& step )
+{
+	{
+		std::lock_guard<std::mutex> lock( mLanesMutex );
+		for( size_t i = 0; i < mLanes.size(); ++i ) {
+			Lane& lane = *mLanes[i];
+			if( lane.job ) {
+				continue;
+			}
+			lane.job = createJob( name, [step] { return step( true ); } );
+			if( ! lane.thread.joinable() ) {
+				lane.thread = std::thread( &CinderNDIThreadPool::threadedBlocking, this, i );
+			}
+			mLanesCondition.notify_all();
+			return lane.job;
+		}
+	}
+	CI_LOG_W( "All " << mLanes.size() << " blocking NDI threads are busy, '" << name << "' polls instead" );
+	return startJob( name, [step] { return step( false ); } );
+}
+
+void CinderNDIThreadPool::stopJob( const std::shared_ptr<Job>& job )
+{
+	if( ! job ) {
+		return;
+	}
+	// a queued or waiting job is dropped when it comes up, a running one finishes its step first.
+	{
+		std::lock_guard<std::mutex> lock( job->mMutex );
+		job->mStopped = true;
+		job->mStep = nullptr;
+	}
+	releasePreciseTiming( *job );
+	// a blocking lane sleeping until the job's next step frees up right away.
+	{
+		std::lock_guard<std::mutex> lock( mLanesMutex );
+	}
+	mLanesCondition.notify_all();
+}
+
+void CinderNDIThreadPool::submit( const std::string& name, const std::function<void()>& task )
+{
+	startJob( name, [task] {
+		task();
+		return kStop;
+	} );
+}
+
+std::vector<CinderNDIThreadPool::JobStats> CinderNDIThreadPool::getJobStats()
+{
+	std::vector<JobStats> stats;
+	std::lock_guard<std::mutex> lock( mJobsMutex );
+	for( const auto& known : mJobs ) {
+		auto job = known.lock();
+		if( ! job ) {
+			continue;
+		}
+		JobStats jobStats;
+		jobStats.name = job->mName;
+		jobStats.numRuns = job->mNumRuns;
+		jobStats.totalSeconds = job->mTotalNanos * 1e-9;
+		jobStats.maxSeconds = job->mMaxNanos * 1e-9;
+		jobStats.maxLateness = job->mMaxLatenessNanos * 1e-9;
+		stats.push_back( jobStats );
+	}
+	return stats;
+}
+
+void CinderNDIThreadPool::enqueue( size_t index, const std::shared_ptr<Job>& job )
+{
+	{
+		std::lock_guard<std::mutex> lock( mWorkers[index]->mutex );
+		mWorkers[index]->queue.push_back( job );
+	}
+	++mNumQueued;
+	// taking the lock orders this with a worker that checked mNumQueued and is about to sleep.
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+	}
+	mCondition.notify_one();
+}
+
+bool CinderNDIThreadPool::popJob( size_t index, std::shared_ptr<Job>& job )
+{
+	// the own queue from the front, the others from the back, so a thief takes the work its owner gets to last.
+	for( size_t i = 0; i < mWorkers.size(); ++i ) {
+		Worker& worker = *mWorkers[( index + i ) % mWorkers.size()];
+		std::lock_guard<std::mutex> lock( worker.mutex );
+		if( worker.queue.empty() ) {
+			continue;
+		}
+		if( i == 0 ) {
+			job = std::move( worker.queue.front() );
+			worker.queue.pop_front();
+		}
+		else {
+			job = std::move( worker.queue.back() );
+			worker.queue.pop_back();
+		}
+		--mNumQueued;
+		return true;
+	}
+	return false;
+}
+
+void CinderNDIThreadPool::moveDueTimers( size_t index )
+{
+	// due jobs join the back of the queue, so a job that always wants to run again can't starve them.
+	std::vector<std::shared_ptr<Job>> due;
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		const auto now = Clock::now();
+		while( ! mTimers.empty() && mTimers.top().time <= now ) {
+			due.push_back( mTimers.top().job );
+			mTimers.pop();
+		}
+	}
+	if( due.empty() ) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock( mWorkers[index]->mutex );
+		mWorkers[index]->queue.insert( mWorkers[index]->queue.end(), due.begin(), due.end() );
+	}
+	mNumQueued += due.size();
+	// more than one due job is work for other threads as well.
+	if( due.size() > 1 ) {
+		mCondition.notify_all();
+	}
+}
+
+void CinderNDIThreadPool::threadedWork( size_t index )
+{
+	configureThread( index, mOptions.pinThreads );
+
+	while( ! mQuit ) {
+		moveDueTimers( index );
+		std::shared_ptr<Job> job;
+		if( popJob( index, job ) ) {
+			run( index, job );
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( mMutex );
+		if( mQuit || mNumQueued > 0 ) {
+			continue;
+		}
+		if( mTimers.empty() ) {
+			mCondition.wait( lock );
+		}
+		else if( mTimers.top().time > Clock::now() ) {
+			mCondition.wait_until( lock, mTimers.top().time );
+		}
+	}
+}
+
+void CinderNDIThreadPool::threadedBlocking( size_t index )
+{
+	// blocking jobs spend their time waiting, pinning them would only take a core from the workers.
+	configureThread( index, false );
+
+	std::unique_lock<std::mutex> lock( mLanesMutex );
+	while( ! mQuit ) {
+		auto job = mLanes[index]->job;
+		if( ! job ) {
+			mLanesCondition.wait( lock );
+			continue;
+		}
+
+		lock.unlock();
+		Clock::time_point next;
+		const bool running = runStep( job, next );
+		lock.lock();
+
+		if( ! running ) {
+			mLanes[index]->job.reset();
+		}
+		else if( next > Clock::now() ) {
+			mLanesCondition.wait_until( lock, next, [this, &job] { return mQuit || job->mStopped; } );
+		}
+	}
+}
+
+bool CinderNDIThreadPool::runStep( const std::shared_ptr<Job>& job, Clock::time_point& next )
+{
+	std::lock_guard<std::mutex> lock( job->mMutex );
+	if( job->mStopped ) {
+		return false;
+	}
+
+	const auto begin = Clock::now();
+	if( begin > job->mDueTime ) {
+		updateMax( job->mMaxLatenessNanos, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( begin - job->mDueTime ).count() );
+	}
+	next = job->mStep();
+	const uint64_t nanos = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - begin ).count();
+	++job->mNumRuns;
+	job->mTotalNanos += nanos;
+	updateMax( job->mMaxNanos, nanos );
+
+	if( next == kStop ) {
+		job->mStopped = true;
+		job->mStep = nullptr;
+		releasePreciseTiming( *job );
+		return false;
+	}
+	job->mDueTime = next;
+	return true;
+}
+
+void CinderNDIThreadPool::run( size_t index, const std::shared_ptr<Job>& job )
+{
+	Clock::time_point next;
+	if( ! runStep( job, next ) ) {
+		return;
+	}
+
+	if( next <= Clock::now() ) {
+		// stays with this thread, where its data is likely still in the cache.
+		enqueue( index, job );
+		return;
+	}
+
+	bool earliest;
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		earliest = mTimers.empty() || next < mTimers.top().time;
+		mTimers.push( Timer{ next, job } );
+	}
+	// sleeping threads wait for the earliest timer, only a new earliest one needs to wake them.
+	if( earliest ) {
+		mCondition.notify_one();
+	}
+}
+
+void CinderNDIThreadPool::releasePreciseTiming( Job& job )
+{
+	if( job.mPreciseTiming.exchange( false ) ) {
+		endPreciseTiming();
+	}
+}
+
+void CinderNDIThreadPool::configureThread( size_t index, bool pin )
+{
+	const unsigned numCores = std::max( std::thread::hardware_concurrency(), 1u );
+#if defined( _WIN32 )
+	if( pin ) {
+		SetThreadAffinityMask( GetCurrentThread(), (DWORD_PTR)1 << ( index % numCores ) );
+	}
+	if( mOptions.priority == Priority::High ) {
+		SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL );
+	}
+#elif defined( __linux__ )
+	if( pin ) {
+		cpu_set_t cpus;
+		CPU_ZERO( &cpus );
+		CPU_SET( index % numCores, &cpus );
+		if( pthread_setaffinity_np( pthread_self(), sizeof( cpus ), &cpus ) != 0 ) {
+			CI_LOG_W( "Failed to pin NDI worker thread " << index );
+		}
+	}
+#else
+	(void)index;
+	(void)pin;
+	(void)numCores;
+#endif
+}
@@ -0,0 +1,82 @@
+#include "CinderNDIUploadScheduler.h"
+
+#include <algorithm>
+
+#include "CinderNDIReceiver.h"
+
+CinderNDIUploadScheduler::CinderNDIUploadScheduler( size_t bytesPerFrame )
+	: mBudget{ bytesPerFrame }, mNumBytesThisFrame{ 0 }, mNumBytesLastFrame{ 0 }, mPeakBytesPerFrame{ 0 }
+{
+	resetStats();
+}
+
+void CinderNDIUploadScheduler::addReceiver( CinderNDIReceiver* receiver )
+{
+	if( std::find( mReceivers.begin(), mReceivers.end(), receiver ) == mReceivers.end() ) {
+		mReceivers.push_back( receiver );
+	}
+}
+
+void CinderNDIUploadScheduler::removeReceiver( CinderNDIReceiver* receiver )
+{
+	mReceivers.erase( std::remove( mReceivers.begin(), mReceivers.end(), receiver ), mReceivers.end() );
+}
+
+void CinderNDIUploadScheduler::beginFrame()
+{
+	mNumBytesLastFrame = mNumBytesThisFrame;
+	mNumBytesThisFrame = 0;
+}
+
+void CinderNDIUploadScheduler::update()
+{
+	beginFrame();
+
+	// a copy, so receivers leaving the scheduler from a frame callback don't invalidate the loop.
+	auto receivers = mReceivers;
+	std::stable_sort( receivers.begin(), receivers.end(), []( const CinderNDIReceiver* a, const CinderNDIReceiver* b ) {
+		return a->getUploadPriority() < b->getUploadPriority();
+	} );
+	for( auto receiver : receivers ) {
+		receiver->update();
+	}
+}
+
+CinderNDIUploadScheduler::Decision CinderNDIUploadScheduler::schedule( size_t bytes, Priority priority )
+{
+	Stats& stats = mStats[(int)priority];
+	if( mBudget == 0 || mNumBytesThisFrame == 0 || mNumBytesThisFrame + bytes <= mBudget ) {
+		mNumBytesThisFrame += bytes;
+		mPeakBytesPerFrame = std::max( mPeakBytesPerFrame, mNumBytesThisFrame );
+		++stats.framesUploaded;
+		stats.bytesUploaded += bytes;
+		return Decision::Upload;
+	}
+	if( priority == Priority::Background ) {
+		++stats.framesDropped;
+		return Decision::Drop;
+	}
+	++stats.framesDeferred;
+	return Decision::Defer;
+}
+
+CinderNDIUploadScheduler::Stats CinderNDIUploadScheduler::getTotalStats() const
+{
+	Stats total = Stats();
+	for( const auto& stats : mStats ) {
+		total.framesUploaded += stats.framesUploaded;
+		total.framesDeferred += stats.framesDeferred;
+		total.framesReplaced += stats.framesReplaced;
+		total.framesDropped += stats.framesDropped;
+		total.bytesUploaded += stats.bytesUploaded;
+	}
+	return total;
+}
+
+void CinderNDIUploadScheduler::resetStats()
+{
+	for( auto& stats : mStats ) {
+		stats = Stats();
+	}
+	mPeakBytesPerFrame = 0;
+}
@@ -0,0 +1,256 @@
+#include "CinderNDIVideoWall.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "cinder/Log.h"
+
+namespace {
+
+// Must match the array sizes in the shader, larger walls are drawn in several batches.
+const int kMaxTilesPerDraw = 64;
+
+// The quad of each instance is built from gl_VertexID, so the draw needs no vertex data at all.
+const char* kVertexShader = R"(
+#version 150
+uniform mat4 ciModelViewProjection;
+uniform vec4 uRects[64];		// x, y, width, height in window space
+uniform vec4 uRegions[64];		// u scale, v scale, layer
+out vec3 vTexCoord;
+void main() {
+	vec2 corner = vec2( gl_VertexID & 1, gl_VertexID >> 1 );
+	vec4 rect = uRects[gl_InstanceID];
+	vec4 region = uRegions[gl_InstanceID];
+	vTexCoord = vec3( corner * region.xy, region.z );
+	gl_Position = ciModelViewProjection * vec4( rect.xy + corner * rect.zw, 0.0, 1.0 );
+}
+)";
+
+const char* kFragmentShader = R"(
+#version 150
+uniform sampler2DArray uLayers;
+in vec3 vTexCoord;
+out vec4 oColor;
+void main() {
+	oColor = texture( uLayers, vTexCoord );
+}
+)";
+
+} // anonymous namespace
+
+CinderNDIVideoWall::CinderNDIVideoWall( int layerWidth, int layerHeight, size_t maxSources )
+	: mLayerWidth{ layerWidth }, mLayerHeight{ layerHeight }, mMaxSources{ maxSources },
+	mUploadScheduler{ std::make_shared<CinderNDIUploadScheduler>() }, mOwnsUploadScheduler{ true }, mNumBytesUploaded{ 0 },
+	mNextTile{ 0 }, mNumReplacedFrames{ 0 }
+{
+	mTiles.reserve( mMaxSources );
+}
+
+void CinderNDIVideoWall::setUploadScheduler( const std::shared_ptr<CinderNDIUploadScheduler>& scheduler )
+{
+	if( ! scheduler ) {
+		return;
+	}
+	mUploadScheduler = scheduler;
+	mOwnsUploadScheduler = false;
+}
+
+int CinderNDIVideoWall::addSource( const std::string& senderName )
+{
+	if( mTiles.size() >= mMaxSources ) {
+		CI_LOG_E( "NDI video wall is full, can't add '" << senderName << "'" );
+		return -1;
+	}
+
+	const size_t index = mTiles.size();
+	mTiles.emplace_back();
+	Tile& tile = mTiles.back();
+	tile.receiver.reset( new CinderNDIReceiver() );
+	tile.width = tile.height = 0;
+	tile.hasContent = false;
+	tile.pendingWidth = tile.pendingHeight = 0;
+	tile.hasPending = false;
+
+	tile.receiver->setTextureUploadEnabled( false );
+	tile.receiver->setVideoFrameCallback( [this, index]( const NDIlib_video_frame_v2_t& videoFrame ) {
+		onVideoFrame( index, videoFrame );
+	} );
+	tile.receiver->setup( senderName );
+	return (int)index;
+}
+
+void CinderNDIVideoWall::layoutGrid( const ci::Rectf& bounds, int columns )
+{
+	if( mTiles.empty() ) {
+		return;
+	}
+	if( columns <= 0 ) {
+		columns = (int)std::ceil( std::sqrt( (double)mTiles.size() ) );
+	}
+	const int rows = (int)( ( mTiles.size() + columns - 1 ) / columns );
+	const float width = bounds.getWidth() / columns;
+	const float height = bounds.getHeight() / rows;
+	for( size_t i = 0; i < mTiles.size(); ++i ) {
+		const float x = bounds.x1 + ( i % columns ) * width;
+		const float y = bounds.y1 + ( i / columns ) * height;
+		mTiles[i].rect = ci::Rectf( x, y, x + width, y + height );
+	}
+}
+
+size_t CinderNDIVideoWall::getNumDeferredFrames() const
+{
+	size_t count = 0;
+	for( const auto& tile : mTiles ) {
+		count += tile.hasPending ? 1 : 0;
+	}
+	return count;
+}
+
+void CinderNDIVideoWall::upload( size_t index, const uint8_t* data, int stride, int width, int height )
+{
+	if( ! mLayers ) {
+		auto format = ci::gl::Texture3d::Format().target( GL_TEXTURE_2D_ARRAY ).internalFormat( GL_RGBA8 ).minFilter( GL_LINEAR ).magFilter( GL_LINEAR ).wrap( GL_CLAMP_TO_EDGE );
+		mLayers = ci::gl::Texture3d::create( mLayerWidth, mLayerHeight, (int)mMaxSources, format );
+	}
+
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, stride / 4 );
+	mLayers->update( data, GL_BGRA, GL_UNSIGNED_BYTE, 0, width, height, 1, 0, 0, (int)index );
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+
+	Tile& tile = mTiles[index];
+	tile.width = width;
+	tile.height = height;
+	tile.hasContent = true;
+	mNumBytesUploaded += (size_t)width * height * 4;
+}
+
+void CinderNDIVideoWall::onVideoFrame( size_t index, const NDIlib_video_frame_v2_t& videoFrame )
+{
+	if( ( videoFrame.FourCC != NDIlib_FourCC_type_BGRA && videoFrame.FourCC != NDIlib_FourCC_type_BGRX ) || ! videoFrame.p_data ) {
+		return;
+	}
+
+	const int width = std::min( videoFrame.xres, mLayerWidth );
+	const int height = std::min( videoFrame.yres, mLayerHeight );
+	if( width <= 0 || height <= 0 ) {
+		return;
+	}
+	const int stride = videoFrame.line_stride_in_bytes ? videoFrame.line_stride_in_bytes : videoFrame.xres * 4;
+	const size_t rowBytes = (size_t)width * 4;
+
+	// a tile with a deferred frame waits its turn, uploading past it would let it jump the queue.
+	Tile& tile = mTiles[index];
+	const auto priority = tile.receiver->getUploadPriority();
+	if( tile.hasPending ) {
+		++mNumReplacedFrames;
+		mUploadScheduler->countReplaced( priority );
+	}
+	else {
+		const auto decision = mUploadScheduler->schedule( rowBytes * height, priority );
+		if( decision == CinderNDIUploadScheduler::Decision::Upload ) {
+			upload( index, videoFrame.p_data, stride, width, height );
+			return;
+		}
+		if( decision == CinderNDIUploadScheduler::Decision::Drop ) {
+			return;
+		}
+	}
+
+	// NDI wants the frame back after the callback, so the deferred one is copied.
+	tile.pending.resize( rowBytes * height );
+	for( int y = 0; y < height; ++y ) {
+		std::memcpy( tile.pending.data() + y * rowBytes, videoFrame.p_data + (ptrdiff_t)y * stride, rowBytes );
+	}
+	tile.pendingWidth = width;
+	tile.pendingHeight = height;
+	tile.hasPending = true;
+}
+
+void CinderNDIVideoWall::update()
+{
+	mNumBytesUploaded = 0;
+	if( mOwnsUploadScheduler ) {
+		mUploadScheduler->beginFrame();
+	}
+
+	// deferred frames go first, starting where the last update ran out of budget.
+	const size_t numTiles = mTiles.size();
+	size_t firstSkipped = numTiles;
+	for( size_t n = 0; n < numTiles; ++n ) {
+		const size_t i = ( mNextTile + n ) % numTiles;
+		Tile& tile = mTiles[i];
+		if( ! tile.hasPending ) {
+			continue;
+		}
+		const auto decision = mUploadScheduler->schedule( (size_t)tile.pendingWidth * tile.pendingHeight * 4, tile.receiver->getUploadPriority() );
+		if( decision == CinderNDIUploadScheduler::Decision::Defer ) {
+			if( firstSkipped == numTiles ) {
+				firstSkipped = i;
+			}
+			continue;
+		}
+		// dropped when the tile was hidden while the frame was waiting.
+		if( decision == CinderNDIUploadScheduler::Decision::Upload ) {
+			upload( i, tile.pending.data(), tile.pendingWidth * 4, tile.pendingWidth, tile.pendingHeight );
+		}
+		tile.hasPending = false;
+	}
+	if( firstSkipped != numTiles ) {
+		mNextTile = firstSkipped;
+	}
+
+	for( auto& tile : mTiles ) {
+		tile.receiver->update();
+	}
+}
+
+void CinderNDIVideoWall::draw()
+{
+	if( ! mLayers ) {
+		return;
+	}
+
+	if( ! mProg ) {
+		try {
+			mProg = ci::gl::GlslProg::create( ci::gl::GlslProg::Format().vertex( kVertexShader ).fragment( kFragmentShader ) );
+		}
+		catch( const std::exception& e ) {
+			CI_LOG_E( "Failed to create NDI video wall shader: " << e.what() );
+			return;
+		}
+		mVao = ci::gl::Vao::create();
+	}
+
+	ci::gl::ScopedGlslProg scopedProg( mProg );
+	ci::gl::ScopedTextureBind scopedLayers( mLayers, 0 );
+	ci::gl::ScopedVao scopedVao( mVao );
+	ci::gl::setDefaultShaderVars();
+	mProg->uniform( "uLayers", 0 );
+
+	ci::vec4 rects[kMaxTilesPerDraw];
+	ci::vec4 regions[kMaxTilesPerDraw];
+	int count = 0;
+	for( size_t i = 0; i < mTiles.size(); ++i ) {
+		const Tile& tile = mTiles[i];
+		if( ! tile.hasContent ) {
+			continue;
+		}
+		rects[count] = ci::vec4( tile.rect.x1, tile.rect.y1, tile.rect.getWidth(), tile.rect.getHeight() );
+		regions[count] = ci::vec4( (float)tile.width / mLayerWidth, (float)tile.height / mLayerHeight, (float)i, 0.0f );
+		if( ++count == kMaxTilesPerDraw ) {
+			drawTiles( rects, regions, count );
+			count = 0;
+		}
+	}
+	if( count ) {
+		drawTiles( rects, regions, count );
+	}
+}
+
+void CinderNDIVideoWall::drawTiles( const ci::vec4* rects, const ci::vec4* regions, int count )
+{
+	mProg->uniform( "uRects", rects, count );
+	mProg->uniform( "uRegions", regions, count );
+	ci::gl::drawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, count );
+}
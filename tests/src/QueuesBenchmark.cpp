@@ -0,0 +1,171 @@
+// Measures the hand-offs in CinderNDIQueues.h against a std::deque behind a std::mutex, the way the
+// receiver and the sender passed frames around before. Prints one line per case; not registered with
+// ctest, run it by hand on an otherwise idle machine with a release build.
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+#include "CinderNDIQueues.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const uint64_t kNumValues = 2000000;
+const size_t kCapacity = 1024;
+
+// the lock-based baseline, bounded like the queues so a fast producer can't run away.
+template<typename T>
+class MutexQueue{
+	public:
+		explicit MutexQueue( size_t capacity ) : mCapacity{ capacity } {}
+
+		bool push( T&& value )
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			if( mValues.size() >= mCapacity ) {
+				return false;
+			}
+			mValues.push_back( std::move( value ) );
+			return true;
+		}
+		bool pop( T& value )
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			if( mValues.empty() ) {
+				return false;
+			}
+			value = std::move( mValues.front() );
+			mValues.pop_front();
+			return true;
+		}
+	private:
+		const size_t		mCapacity;
+		std::mutex			mMutex;
+		std::deque<T>		mValues;
+};
+
+void report( const std::string& name, int numProducers, Clock::duration elapsed, uint64_t numValues )
+{
+	const double seconds = std::chrono::duration<double>( elapsed ).count();
+	std::cout << std::left << std::setw( 28 ) << name
+		<< std::setw( 12 ) << ( std::to_string( numProducers ) + " producer" + ( numProducers > 1 ? "s" : "" ) )
+		<< std::right << std::fixed << std::setprecision( 1 )
+		<< std::setw( 10 ) << numValues / seconds / 1e6 << " M/s"
+		<< std::setw( 10 ) << std::chrono::duration<double, std::nano>( elapsed ).count() / numValues << " ns/value"
+		<< std::endl;
+}
+
+// numProducers threads push kNumValues values in total, the calling thread pops them all.
+template<typename Queue>
+void run( const std::string& name, Queue& queue, int numProducers )
+{
+	const uint64_t numPerProducer = kNumValues / numProducers;
+	std::atomic_bool start( false );
+	std::vector<std::thread> producers;
+	for( int p = 0; p < numProducers; ++p ) {
+		producers.emplace_back( [&] {
+			while( ! start ) {
+				std::this_thread::yield();
+			}
+			for( uint64_t i = 0; i < numPerProducer; ++i ) {
+				uint64_t value = i;
+				while( ! queue.push( std::move( value ) ) ) {
+					std::this_thread::yield();
+				}
+			}
+		} );
+	}
+
+	const uint64_t total = numPerProducer * numProducers;
+	uint64_t numReceived = 0, value = 0;
+	const auto begin = Clock::now();
+	start = true;
+	while( numReceived < total ) {
+		if( queue.pop( value ) ) {
+			++numReceived;
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+	const auto elapsed = Clock::now() - begin;
+	for( auto& producer : producers ) {
+		producer.join();
+	}
+	report( name, numProducers, elapsed, total );
+}
+
+void runTripleBuffer()
+{
+	CinderNDITripleBuffer<uint64_t> buffer;
+	std::atomic_bool start( false ), done( false );
+	std::thread producer( [&] {
+		while( ! start ) {
+			std::this_thread::yield();
+		}
+		for( uint64_t i = 0; i < kNumValues; ++i ) {
+			buffer.getWriteBuffer() = i;
+			buffer.publish();
+		}
+		done = true;
+	} );
+
+	uint64_t numUpdates = 0;
+	const auto begin = Clock::now();
+	start = true;
+	while( ! done ) {
+		if( buffer.update() ) {
+			++numUpdates;
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+	const auto elapsed = Clock::now() - begin;
+	producer.join();
+	// the last value may still be waiting.
+	if( buffer.update() ) {
+		++numUpdates;
+	}
+	report( "CinderNDITripleBuffer", 1, elapsed, kNumValues );
+	std::cout << "    " << numUpdates << " of " << kNumValues << " values picked up, "
+		<< buffer.getNumOverwritten() << " overwritten" << std::endl;
+}
+
+} // anonymous namespace
+
+int main()
+{
+	std::cout << kNumValues << " values, capacity " << kCapacity << ", "
+		<< std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+	{
+		MutexQueue<uint64_t> queue( kCapacity );
+		run( "std::mutex + std::deque", queue, 1 );
+	}
+	{
+		CinderNDISpscQueue<uint64_t> queue( kCapacity );
+		run( "CinderNDISpscQueue", queue, 1 );
+	}
+	for( int numProducers : { 2, 4 } ) {
+		{
+			MutexQueue<uint64_t> queue( kCapacity );
+			run( "std::mutex + std::deque", queue, numProducers );
+		}
+		{
+			CinderNDIMpscQueue<uint64_t> queue( kCapacity );
+			run( "CinderNDIMpscQueue", queue, numProducers );
+		}
+	}
+	runTripleBuffer();
+	return 0;
+}
@@ -0,0 +1,261 @@
+// Exercises the hand-offs in CinderNDIQueues.h, single threaded and between threads. Meant to be run under
+// ThreadSanitizer as well, see tests/proj/cmake/CMakeLists.txt. Exits non-zero on failure.
+
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "CinderNDIQueues.h"
+
+namespace {
+
+int sNumFailures = 0;
+
+#define CHECK( condition ) \
+	do { \
+		if( ! ( condition ) ) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": failed: " #condition << std::endl; \
+			++sNumFailures; \
+		} \
+	} while( 0 )
+
+const uint64_t kNumStressValues = 200000;
+
+void testSpscBasics()
+{
+	CinderNDISpscQueue<int> queue( 3 );
+	CHECK( queue.capacity() == 4 );
+	CHECK( queue.empty() );
+
+	int value = 0;
+	CHECK( ! queue.pop( value ) );
+	for( int i = 0; i < 4; ++i ) {
+		CHECK( queue.push( i ) );
+	}
+	CHECK( ! queue.push( 4 ) );
+	CHECK( queue.size() == 4 );
+
+	for( int i = 0; i < 4; ++i ) {
+		CHECK( queue.pop( value ) );
+		CHECK( value == i );
+	}
+	CHECK( ! queue.pop( value ) );
+	CHECK( queue.empty() );
+}
+
+void testSpscBufferReuse()
+{
+	// buffers swapped in by pop() come back to the producer with their capacity.
+	CinderNDISpscQueue<std::vector<uint8_t>> queue( 2 );
+	std::vector<uint8_t> produced( 1024, 1 );
+	CHECK( queue.pushSwap( produced ) );
+	CHECK( produced.empty() );
+
+	std::vector<uint8_t> consumed;
+	consumed.reserve( 4096 );
+	CHECK( queue.pop( consumed ) );
+	CHECK( consumed.size() == 1024 && consumed[0] == 1 );
+
+	// one lap later the producer gets the consumer's old buffer back.
+	std::vector<uint8_t> next( 16, 2 );
+	CHECK( queue.pushSwap( next ) );
+	CHECK( queue.pop( consumed ) );
+	next.assign( 16, 3 );
+	CHECK( queue.pushSwap( next ) );
+	CHECK( next.capacity() >= 4096 );
+}
+
+void testSpscThreads()
+{
+	CinderNDISpscQueue<uint64_t> queue( 64 );
+	std::thread producer( [&] {
+		for( uint64_t i = 0; i < kNumStressValues; ++i ) {
+			while( ! queue.push( i ) ) {
+				std::this_thread::yield();
+			}
+		}
+	} );
+
+	bool inOrder = true;
+	uint64_t expected = 0, value = 0;
+	while( expected < kNumStressValues ) {
+		if( queue.pop( value ) ) {
+			inOrder = inOrder && value == expected;
+			++expected;
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	CHECK( inOrder );
+	CHECK( queue.empty() );
+}
+
+void testMpscBasics()
+{
+	CinderNDIMpscQueue<int> queue( 4 );
+	CHECK( queue.capacity() == 4 );
+
+	int value = 0;
+	CHECK( ! queue.pop( value ) );
+	for( int i = 0; i < 4; ++i ) {
+		CHECK( queue.push( i ) );
+	}
+	CHECK( ! queue.push( 4 ) );
+	for( int i = 0; i < 4; ++i ) {
+		CHECK( queue.pop( value ) );
+		CHECK( value == i );
+	}
+	CHECK( ! queue.pop( value ) );
+
+	// wraps around more than once.
+	for( int i = 0; i < 10; ++i ) {
+		CHECK( queue.push( i ) );
+		CHECK( queue.pop( value ) );
+		CHECK( value == i );
+	}
+}
+
+void testMpscThreads()
+{
+	const int numProducers = 4;
+	const uint64_t numPerProducer = kNumStressValues / numProducers;
+	CinderNDIMpscQueue<uint64_t> queue( 64 );
+
+	std::vector<std::thread> producers;
+	for( int p = 0; p < numProducers; ++p ) {
+		producers.emplace_back( [&queue, p, numPerProducer] {
+			for( uint64_t i = 0; i < numPerProducer; ++i ) {
+				// producer in the top bits, so the consumer can check each producer's order.
+				const uint64_t value = ( (uint64_t)p << 48 ) | i;
+				while( ! queue.push( value ) ) {
+					std::this_thread::yield();
+				}
+			}
+		} );
+	}
+
+	std::vector<uint64_t> next( numProducers, 0 );
+	bool inOrder = true;
+	uint64_t numReceived = 0, value = 0;
+	while( numReceived < numPerProducer * numProducers ) {
+		if( queue.pop( value ) ) {
+			const size_t producer = (size_t)( value >> 48 );
+			const uint64_t index = value & ( ( (uint64_t)1 << 48 ) - 1 );
+			if( producer >= next.size() || index != next[producer] ) {
+				inOrder = false;
+			}
+			else {
+				++next[producer];
+			}
+			++numReceived;
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+	for( auto& producer : producers ) {
+		producer.join();
+	}
+	CHECK( inOrder );
+	for( uint64_t count : next ) {
+		CHECK( count == numPerProducer );
+	}
+	CHECK( ! queue.pop( value ) );
+}
+
+void testTripleBufferBasics()
+{
+	CinderNDITripleBuffer<int> buffer;
+	CHECK( ! buffer.update() );
+
+	buffer.getWriteBuffer() = 1;
+	CHECK( buffer.publish() );
+	CHECK( buffer.update() );
+	CHECK( buffer.getReadBuffer() == 1 );
+	CHECK( ! buffer.update() );
+	CHECK( buffer.getReadBuffer() == 1 );
+
+	// the newest value wins, the one in between is counted as overwritten.
+	buffer.getWriteBuffer() = 2;
+	CHECK( buffer.publish() );
+	buffer.getWriteBuffer() = 3;
+	CHECK( ! buffer.publish() );
+	CHECK( buffer.update() );
+	CHECK( buffer.getReadBuffer() == 3 );
+
+	CHECK( buffer.getNumPublished() == 3 );
+	CHECK( buffer.getNumOverwritten() == 1 );
+}
+
+void testTripleBufferThreads()
+{
+	struct Value {
+		uint64_t	index = 0;
+		uint64_t	check = 0;
+	};
+	CinderNDITripleBuffer<Value> buffer;
+	std::atomic_bool done( false );
+
+	std::thread producer( [&] {
+		for( uint64_t i = 1; i <= kNumStressValues; ++i ) {
+			Value& value = buffer.getWriteBuffer();
+			value.index = i;
+			value.check = ~i;
+			buffer.publish();
+			if( i % 64 == 0 ) {
+				std::this_thread::yield();
+			}
+		}
+		done = true;
+	} );
+
+	bool consistent = true, increasing = true;
+	uint64_t last = 0, numUpdates = 0;
+	while( true ) {
+		const bool finished = done;
+		if( buffer.update() ) {
+			const Value& value = buffer.getReadBuffer();
+			consistent = consistent && value.check == ~value.index;
+			increasing = increasing && value.index > last;
+			last = value.index;
+			++numUpdates;
+		}
+		else if( finished ) {
+			break;
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+
+	CHECK( consistent );
+	CHECK( increasing );
+	CHECK( last == kNumStressValues );
+	CHECK( buffer.getNumPublished() == kNumStressValues );
+	CHECK( buffer.getNumOverwritten() == kNumStressValues - numUpdates );
+}
+
+} // anonymous namespace
+
+int main()
+{
+	testSpscBasics();
+	testSpscBufferReuse();
+	testSpscThreads();
+	testMpscBasics();
+	testMpscThreads();
+	testTripleBufferBasics();
+	testTripleBufferThreads();
+
+	if( sNumFailures ) {
+		std::cerr << sNumFailures << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "CinderNDIQueues tests passed" << std::endl;
+	return 0;
+}
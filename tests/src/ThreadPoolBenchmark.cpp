@@ -0,0 +1,144 @@
+// Measures CinderNDIThreadPool: how long a submitted task waits for a worker, how late timers fire, how
+// many short steps the workers get through and how precisely a job paced by a CinderNDIFrameClock hits
+// its ticks. Not registered with ctest, run it by hand on an otherwise idle machine with a release build.
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+
+#include "CinderNDIThreadPool.h"
+#include "CinderNDIFrameClock.h"
+
+namespace {
+
+typedef CinderNDIThreadPool::Clock Clock;
+
+double toMicroseconds( Clock::duration duration )
+{
+	return std::chrono::duration<double, std::micro>( duration ).count();
+}
+
+// mean, median and worst of a set of samples in microseconds.
+void report( const std::string& name, std::vector<double> samples )
+{
+	if( samples.empty() ) {
+		std::cout << std::left << std::setw( 36 ) << name << "no samples" << std::endl;
+		return;
+	}
+	std::sort( samples.begin(), samples.end() );
+	double sum = 0.0;
+	for( double sample : samples ) {
+		sum += sample;
+	}
+	std::cout << std::left << std::setw( 36 ) << name << std::right << std::fixed << std::setprecision( 1 )
+		<< "mean " << std::setw( 9 ) << sum / samples.size() << " us"
+		<< "   median " << std::setw( 9 ) << samples[samples.size() / 2] << " us"
+		<< "   max " << std::setw( 9 ) << samples.back() << " us" << std::endl;
+}
+
+void benchmarkDispatch( CinderNDIThreadPool& pool )
+{
+	const int numTasks = 2000;
+	std::vector<double> latencies( numTasks );
+	for( int i = 0; i < numTasks; ++i ) {
+		std::atomic_bool ran( false );
+		const auto submitted = Clock::now();
+		pool.submit( "dispatch", [&, i] {
+			latencies[i] = toMicroseconds( Clock::now() - submitted );
+			ran = true;
+		} );
+		while( ! ran ) {
+			std::this_thread::yield();
+		}
+	}
+	report( "submit() to run", latencies );
+}
+
+void benchmarkTimers( CinderNDIThreadPool& pool, int numJobs )
+{
+	const auto interval = std::chrono::milliseconds( 5 );
+	std::vector<std::vector<double>> lateness( numJobs );
+	std::vector<std::shared_ptr<CinderNDIThreadPool::Job>> jobs;
+	for( int i = 0; i < numJobs; ++i ) {
+		auto due = std::make_shared<Clock::time_point>( Clock::now() + interval );
+		std::vector<double>* samples = &lateness[i];
+		jobs.push_back( pool.startJob( "timer", [due, samples, interval] {
+			const auto now = Clock::now();
+			samples->push_back( toMicroseconds( now - *due ) );
+			*due = now + interval;
+			return *due;
+		} ) );
+	}
+	std::this_thread::sleep_for( std::chrono::seconds( 1 ) );
+	for( auto& job : jobs ) {
+		pool.stopJob( job );
+	}
+
+	std::vector<double> all;
+	for( const auto& samples : lateness ) {
+		all.insert( all.end(), samples.begin(), samples.end() );
+	}
+	report( "timer lateness, " + std::to_string( numJobs ) + " jobs", all );
+}
+
+void benchmarkThroughput( CinderNDIThreadPool& pool, int numJobs )
+{
+	std::atomic<uint64_t> numRuns( 0 );
+	std::vector<std::shared_ptr<CinderNDIThreadPool::Job>> jobs;
+	for( int i = 0; i < numJobs; ++i ) {
+		jobs.push_back( pool.startJob( "busy", [&numRuns] {
+			++numRuns;
+			return Clock::now();
+		} ) );
+	}
+	const auto begin = Clock::now();
+	std::this_thread::sleep_for( std::chrono::seconds( 1 ) );
+	for( auto& job : jobs ) {
+		pool.stopJob( job );
+	}
+	const double seconds = std::chrono::duration<double>( Clock::now() - begin ).count();
+	std::cout << std::left << std::setw( 36 ) << ( "steps, " + std::to_string( numJobs ) + " busy jobs" )
+		<< std::right << std::fixed << std::setprecision( 2 ) << numRuns / seconds / 1e6 << " M/s" << std::endl;
+}
+
+void benchmarkPacing( CinderNDIThreadPool& pool )
+{
+	// how far after its deadline each tick of a 60 fps clock starts, the way senders pace video.
+	CinderNDIFrameClock clock( 60, 1 );
+	std::vector<double> errors;
+	errors.reserve( 200 );
+	auto job = pool.startJob( "paced", [&] {
+		clock.waitForNextTick();
+		errors.push_back( toMicroseconds( Clock::now() - clock.getDeadline( clock.getTickCount() ) ) );
+		return clock.getNextWakeTime();
+	}, true );
+	std::this_thread::sleep_for( std::chrono::seconds( 2 ) );
+	pool.stopJob( job );
+
+	// the first ticks are spent learning the sleep overshoot.
+	if( errors.size() > 10 ) {
+		errors.erase( errors.begin(), errors.begin() + 10 );
+	}
+	report( "60 fps tick error", errors );
+}
+
+} // anonymous namespace
+
+int main()
+{
+	CinderNDIThreadPool pool;
+	std::cout << pool.getNumThreads() << " worker threads" << std::endl;
+
+	benchmarkDispatch( pool );
+	benchmarkTimers( pool, 1 );
+	benchmarkTimers( pool, 32 );
+	benchmarkThroughput( pool, 1 );
+	benchmarkThroughput( pool, 16 );
+	benchmarkPacing( pool );
+	return 0;
+}
@@ -0,0 +1,232 @@
+// Exercises CinderNDIThreadPool: scheduling, stopping, timers, fairness and the blocking lane. Meant to
+// be run under ThreadSanitizer as well, see tests/proj/cmake/CMakeLists.txt. Exits non-zero on failure.
+
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include "CinderNDIThreadPool.h"
+
+namespace {
+
+int sNumFailures = 0;
+
+#define CHECK( condition ) \
+	do { \
+		if( ! ( condition ) ) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": failed: " #condition << std::endl; \
+			++sNumFailures; \
+		} \
+	} while( 0 )
+
+typedef CinderNDIThreadPool::Clock Clock;
+
+CinderNDIThreadPool::Options makeOptions( int numThreads, int numBlockingThreads )
+{
+	CinderNDIThreadPool::Options options;
+	options.numThreads = numThreads;
+	options.numBlockingThreads = numBlockingThreads;
+	return options;
+}
+
+void testStopJob()
+{
+	CinderNDIThreadPool pool( makeOptions( 2, 0 ) );
+	std::atomic<uint64_t> numRuns( 0 );
+	std::atomic_bool stopped( false );
+	std::atomic_bool ranAfterStop( false );
+	auto job = pool.startJob( "spin", [&] {
+		if( stopped ) {
+			ranAfterStop = true;
+		}
+		++numRuns;
+		std::this_thread::yield();
+		return Clock::now();
+	} );
+
+	while( numRuns < 1000 ) {
+		std::this_thread::yield();
+	}
+	pool.stopJob( job );
+	stopped = true;
+	const uint64_t runs = numRuns;
+	std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+
+	CHECK( ! ranAfterStop );
+	CHECK( numRuns == runs );
+}
+
+void testStopFromStep()
+{
+	CinderNDIThreadPool pool( makeOptions( 2, 0 ) );
+	std::atomic<int> numRuns( 0 );
+	pool.startJob( "three times", [&] {
+		return ++numRuns == 3 ? CinderNDIThreadPool::kStop : Clock::now();
+	} );
+	std::atomic<int> numTasks( 0 );
+	for( int i = 0; i < 10; ++i ) {
+		pool.submit( "task", [&] { ++numTasks; } );
+	}
+
+	const auto deadline = Clock::now() + std::chrono::seconds( 2 );
+	while( ( numRuns < 3 || numTasks < 10 ) && Clock::now() < deadline ) {
+		std::this_thread::yield();
+	}
+	std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+	CHECK( numRuns == 3 );
+	CHECK( numTasks == 10 );
+}
+
+void testTimers()
+{
+	CinderNDIThreadPool pool( makeOptions( 2, 0 ) );
+	std::atomic<int> numRuns( 0 );
+	const auto interval = std::chrono::milliseconds( 10 );
+	auto job = pool.startJob( "timer", [&] {
+		++numRuns;
+		return Clock::now() + interval;
+	} );
+
+	std::this_thread::sleep_for( std::chrono::milliseconds( 205 ) );
+	pool.stopJob( job );
+	// waits are only ever late, so no more than one run per interval.
+	CHECK( numRuns >= 5 );
+	CHECK( numRuns <= 21 );
+
+	bool found = false;
+	for( const auto& stats : pool.getJobStats() ) {
+		if( stats.name == "timer" ) {
+			found = true;
+			CHECK( stats.numRuns == (uint64_t)numRuns );
+			CHECK( stats.maxLateness >= 0.0 );
+		}
+	}
+	CHECK( found );
+}
+
+void testFairness()
+{
+	// a job that always wants to run again must not starve timers, even on a single worker.
+	CinderNDIThreadPool pool( makeOptions( 1, 0 ) );
+	std::atomic<int> numBusyRuns( 0 ), numTimerRuns( 0 );
+	auto busy = pool.startJob( "busy", [&] {
+		++numBusyRuns;
+		return Clock::now();
+	} );
+	auto timer = pool.startJob( "timer", [&] {
+		++numTimerRuns;
+		return Clock::now() + std::chrono::milliseconds( 5 );
+	} );
+
+	std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+	pool.stopJob( busy );
+	pool.stopJob( timer );
+	CHECK( numBusyRuns > 0 );
+	CHECK( numTimerRuns >= 10 );
+}
+
+void testBlockingLane()
+{
+	// two lanes for three blocking jobs: the third one has to poll.
+	CinderNDIThreadPool pool( makeOptions( 1, 2 ) );
+	std::mutex mutex;
+	std::condition_variable condition;
+	int numSignals = 0;
+	std::atomic<int> numBlockingRuns( 0 ), numPollingRuns( 0 ), numWakeUps( 0 );
+
+	auto step = [&]( bool mayBlock ) {
+		if( ! mayBlock ) {
+			++numPollingRuns;
+			return Clock::now() + std::chrono::milliseconds( 1 );
+		}
+		++numBlockingRuns;
+		// stands in for a wait inside the SDK, woken early by a signal.
+		std::unique_lock<std::mutex> lock( mutex );
+		const int seen = numSignals;
+		if( condition.wait_for( lock, std::chrono::milliseconds( 100 ), [&] { return numSignals != seen; } ) ) {
+			++numWakeUps;
+		}
+		return Clock::now();
+	};
+	auto first = pool.startBlockingJob( "blocking 1", step );
+	auto second = pool.startBlockingJob( "blocking 2", step );
+	auto third = pool.startBlockingJob( "blocking 3", step );
+
+	std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+	for( int i = 0; i < 5; ++i ) {
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			++numSignals;
+		}
+		condition.notify_all();
+		std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+	}
+
+	const auto begin = Clock::now();
+	pool.stopJob( first );
+	pool.stopJob( second );
+	pool.stopJob( third );
+	// waits for the blocking steps to return, which takes about their timeout at most. Generous for
+	// sanitizer builds on loaded machines, it only has to catch a stop that hangs.
+	CHECK( Clock::now() - begin < std::chrono::seconds( 2 ) );
+
+	CHECK( numBlockingRuns > 0 );
+	CHECK( numPollingRuns > 0 );
+	CHECK( numWakeUps > 0 );
+
+	// the stopped jobs freed their lanes.
+	std::atomic<int> numLaneRuns( 0 );
+	auto again = pool.startBlockingJob( "blocking again", [&]( bool mayBlock ) {
+		if( mayBlock ) {
+			++numLaneRuns;
+		}
+		return Clock::now() + std::chrono::milliseconds( 1 );
+	} );
+	const auto deadline = Clock::now() + std::chrono::seconds( 2 );
+	while( numLaneRuns == 0 && Clock::now() < deadline ) {
+		std::this_thread::yield();
+	}
+	pool.stopJob( again );
+	CHECK( numLaneRuns > 0 );
+}
+
+void testManyJobs()
+{
+	CinderNDIThreadPool pool( makeOptions( 4, 2 ) );
+	std::vector<std::shared_ptr<CinderNDIThreadPool::Job>> jobs;
+	std::atomic<uint64_t> numRuns( 0 );
+	for( int i = 0; i < 64; ++i ) {
+		jobs.push_back( pool.startJob( "job " + std::to_string( i ), [&numRuns, i] {
+			++numRuns;
+			return Clock::now() + std::chrono::microseconds( 100 * ( i % 8 ) );
+		} ) );
+	}
+	std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+	for( auto& job : jobs ) {
+		pool.stopJob( job );
+	}
+	CHECK( numRuns >= 64 );
+}
+
+} // anonymous namespace
+
+int main()
+{
+	testStopJob();
+	testStopFromStep();
+	testTimers();
+	testFairness();
+	testBlockingLane();
+	testManyJobs();
+
+	if( sNumFailures ) {
+		std::cerr << sNumFailures << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "CinderNDIThreadPool tests passed" << std::endl;
+	return 0;
+}